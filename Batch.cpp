@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include "Batch.h"
+#include "Error.h"
+
+namespace {
+//    match a file name against a pattern where * is any number of characters and ? any one character
+    bool matchesPattern(std::string_view name, std::string_view pattern) {
+        std::size_t n = 0, p = 0, starPattern = std::string_view::npos, starName = 0;
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++n;
+                ++p;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                starPattern = p++;
+                starName = n;
+            } else if (starPattern != std::string_view::npos) { // let the last * take one more character
+                p = starPattern + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') ++p;
+        return p == pattern.size();
+    }
+}
+
+std::vector<std::string> findBatchInputs(const std::string &source) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> inputFiles;
+    std::error_code error;
+    const bool pattern = source.find_first_of("*?") != std::string::npos;
+    if (pattern || fs::is_directory(source, error)) {
+        const fs::path path(source);
+        const fs::path directory = !pattern ? path : path.has_parent_path() ? path.parent_path() : fs::path(".");
+        const std::string namePattern = pattern ? path.filename().string() : "*";
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            const fs::path &file = it->path();
+            if (it->is_regular_file(error) && matchesPattern(file.filename().string(), namePattern)) {
+                inputFiles.push_back((pattern && !path.has_parent_path() ? file.filename() : file).string());
+            }
+        }
+        if (error) throw MidCrackCodeError("The directory could not be read.");
+        std::sort(inputFiles.begin(), inputFiles.end());
+        return inputFiles;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest.is_open()) throw MidCrackCodeError("The file could not be opened.");
+    for (std::string line; std::getline(manifest, line);) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) inputFiles.push_back(line);
+    }
+    return inputFiles;
+}
+
+BatchSummary runBatch(const std::vector<std::string> &inputFiles, const std::string &outputDirectory,
+                      const std::string &outputExtension, const BatchOperation &operation, ThreadPool &pool) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::create_directories(outputDirectory, error);
+    if (!fs::is_directory(outputDirectory)) throw MidCrackCodeError("The output directory could not be created.");
+
+    std::vector<std::unique_ptr<BatchWorker>> workers;
+    for (unsigned i = 0; i < pool.getNumberOfThreads(); ++i) workers.push_back(std::make_unique<BatchWorker>());
+    std::vector<std::string> errors(inputFiles.size());
+    std::vector<char> failed(inputFiles.size());
+    for (std::size_t i = 0; i < inputFiles.size(); ++i) {
+        pool.submit([&, i] {
+            const fs::path output = fs::path(outputDirectory) /
+                                    fs::path(inputFiles[i]).filename().replace_extension(outputExtension);
+            try {
+                operation(inputFiles[i], output.string(), *workers[pool.getWorkerIndex()]);
+            } catch (const std::exception &exception) {
+                errors[i] = exception.what();
+                failed[i] = 1;
+            }
+        });
+    }
+    pool.wait();
+
+    BatchSummary summary;
+    summary.numberOfFiles = inputFiles.size();
+    for (std::size_t i = 0; i < inputFiles.size(); ++i) {
+        if (failed[i]) summary.failures.emplace_back(inputFiles[i], std::move(errors[i]));
+    }
+    return summary;
+}
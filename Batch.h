@@ -0,0 +1,47 @@
+#ifndef MID_CRACK_CODE_BATCH_H
+#define MID_CRACK_CODE_BATCH_H
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+/// What a worker thread of a batch keeps from one file to the next.
+struct BatchWorker {
+//    the parallel parts of processing a file run on this pool, since the worker cannot wait for its own pool
+    ThreadPool pool;
+//    whole input and output files
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;
+
+    /// \param numberOfThreads Threads of the pool; 0 uses one thread per hardware thread.
+    explicit BatchWorker(unsigned numberOfThreads = 1) : pool(numberOfThreads) {}
+};
+
+/// Outcome of a batch.
+struct BatchSummary {
+    std::size_t numberOfFiles{};
+//    input file and error message of every file that failed, in the order of the inputs
+    std::vector<std::pair<std::string, std::string>> failures;
+};
+
+/// Process one file of a batch.
+using BatchOperation = std::function<void(const std::string &inputFile, const std::string &outputFile,
+                                          BatchWorker &worker)>;
+
+/// Find the input files of a batch.
+/// \param source A directory (all the files in it), a pattern of file names with * and ? (in an existing directory)
+/// or a manifest file with one input file on each line.
+/// \return The files in the order of the manifest, otherwise sorted by name.
+/// \throw MidCrackCodeError If the source cannot be read.
+std::vector<std::string> findBatchInputs(const std::string &source);
+
+/// Process the input files on the thread pool, each with a worker of its thread. The output of an input file is in the
+/// output directory and has the name of the input file with outputExtension instead of its extension.
+/// An error of a file is added to the summary and does not stop the others.
+BatchSummary runBatch(const std::vector<std::string> &inputFiles, const std::string &outputDirectory,
+                      const std::string &outputExtension, const BatchOperation &operation, ThreadPool &pool);
+
+
+#endif //MID_CRACK_CODE_BATCH_H
@@ -0,0 +1,204 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include "BlockContainer.h"
+#include "ContourTracer.h"
+#include "Error.h"
+#include "Files.h"
+#include "Image.h"
+#include "Reconstruction.h"
+#include "Stats.h"
+#include "SyntheticShapes.h"
+#include "ThreadPool.h"
+
+// Benchmark of every stage on synthetic images of growing size. Every measurement is printed as one JSON object per
+// line, so runs can be compared by scripts. The megabytes per second of a stage are of its input: the BMP file for
+// loading, the bitmap (1 bit per pixel) for tracing, the packed digits (3 bits per digit) for reconstructing and
+// compressing, and the compressed bytes for decompressing.
+
+namespace {
+    struct BenchSettings {
+        int minSize = 1024;
+        int maxSize = 4096;
+        int repeat = 3;
+        std::vector<SyntheticShape> shapes{std::begin(allSyntheticShapes), std::end(allSyntheticShapes)};
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+    };
+
+    /// Measurement of one stage on one image.
+    struct StageResult {
+        const char *stage{};
+        double seconds{}; // fastest of the repeated runs
+        double inputBytes{};
+        std::uint64_t pixels{};
+        std::uint64_t symbols{};
+        double compressionRatio{}; // 0 if it is not a compression
+    };
+
+//    fastest time of running the stage `repeat` times
+    double timeStage(int repeat, const std::function<void()> &stage) {
+        double fastest = std::numeric_limits<double>::max();
+        for (int i = 0; i < repeat; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            stage();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            fastest = std::min(fastest, elapsed.count());
+        }
+        return fastest;
+    }
+
+    void printResult(const char *shape, int size, const StageResult &result) {
+        const double seconds = std::max(result.seconds, 1e-9);
+        std::ostringstream line;
+        line << "{\"shape\":\"" << shape << "\",\"size\":" << size << ",\"stage\":\"" << result.stage
+             << "\",\"seconds\":" << result.seconds << ",\"pixelsPerSecond\":" << result.pixels / seconds
+             << ",\"symbolsPerSecond\":" << result.symbols / seconds
+             << ",\"megabytesPerSecond\":" << result.inputBytes / 1e6 / seconds;
+        if (result.compressionRatio > 0) line << ",\"compressionRatio\":" << result.compressionRatio;
+        line << ",\"peakRssKiB\":" << getPeakRssKiB() << "}";
+        std::cout << line.str() << std::endl;
+    }
+
+    void benchImage(SyntheticShape shape, int size, const BenchSettings &settings, ThreadPool &pool) {
+        const char *shapeName = getSyntheticShapeName(shape);
+        const std::uint64_t pixels = (std::uint64_t) size * size;
+        const std::filesystem::path imageFile =
+                settings.directory / ("mid_crack_code_bench_" + std::string(shapeName) + ".bmp");
+        saveBitmap(imageFile.string(), generateSyntheticShape(shape, size, 1));
+        const double fileBytes = (double) std::filesystem::file_size(imageFile);
+
+        std::unique_ptr<Image> image;
+        StageResult load{"load", timeStage(settings.repeat, [&] {
+            std::ifstream file = openInputFile(imageFile.string());
+            image = std::make_unique<Image>(file);
+        }), fileBytes, pixels};
+        std::filesystem::remove(imageFile);
+        printResult(shapeName, size, load);
+
+        MidCrackCode midCrackCode;
+        StageResult trace{"trace", timeStage(settings.repeat, [&] {
+            midCrackCode = traceAllContours(image->getBitmap(), true, pool);
+        }), pixels / 8.0, pixels};
+        image.reset();
+        const std::uint64_t symbols = countDigits(midCrackCode);
+        const double packedBytes = symbols * 3 / 8.0;
+        trace.symbols = symbols;
+        printResult(shapeName, size, trace);
+
+        const StageResult reconstruct{"reconstruct", timeStage(settings.repeat, [&] {
+            reconstructBitmap(midCrackCode, false);
+        }), packedBytes, pixels, symbols};
+        printResult(shapeName, size, reconstruct);
+
+        for (CodecType codec : {CodecType::lzw, CodecType::turns}) {
+            const bool lzw = codec == CodecType::lzw;
+            CompressionSettings compressionSettings;
+            compressionSettings.codec = codec;
+            std::string compressed;
+            StageResult compress{lzw ? "compress-lzw" : "compress-turns", timeStage(settings.repeat, [&] {
+                std::ostringstream output;
+                BlockContainerWriter writer(output, compressionSettings, pool, midCrackCode.imageWidth,
+                                            midCrackCode.imageHeight);
+                for (const MidCrackChain &chain : midCrackCode.chains) {
+                    writer.startChain(chain.startX, chain.startY, chain.startDirection);
+                    writer.append(chain.code);
+                }
+                writer.finish();
+                compressed = std::move(output).str();
+            }), packedBytes, pixels, symbols};
+            compress.compressionRatio = packedBytes / (double) compressed.size();
+            printResult(shapeName, size, compress);
+
+            const std::vector<unsigned char> bytes(compressed.begin(), compressed.end());
+            MidCrackCode decompressed;
+            const StageResult decompress{lzw ? "decompress-lzw" : "decompress-turns", timeStage(settings.repeat, [&] {
+                if (!decompressMidCrackCode(bytes, decompressed, pool)) {
+                    throw MidCrackCodeError("Decompression failed.");
+                }
+            }), (double) bytes.size(), pixels, symbols};
+            if (countDigits(decompressed) != symbols) throw MidCrackCodeError("Decompression failed.");
+            printResult(shapeName, size, decompress);
+        }
+    }
+
+    bool parseNumber(const std::string &setting, int &value) {
+        const std::size_t valueStart = setting.find('=') + 1;
+        if (setting.size() == valueStart || setting.size() - valueStart > 9 ||
+            setting.find_first_not_of("0123456789", valueStart) != std::string::npos) {
+            return false;
+        }
+        value = std::stoi(setting.substr(valueStart));
+        return true;
+    }
+
+    bool parseShapes(const std::string &setting, std::vector<SyntheticShape> &shapes) {
+        shapes.clear();
+        std::istringstream names(setting.substr(setting.find('=') + 1));
+        std::string name;
+        while (std::getline(names, name, ',')) {
+            SyntheticShape shape;
+            if (!findSyntheticShape(name, shape)) return false;
+            shapes.push_back(shape);
+        }
+        return !shapes.empty();
+    }
+
+    void printUsage() {
+        std::cout << "usage: ./mid_crack_code_bench [settings]" << std::endl
+                  << "  --min-size=[pixels]   : side of the smallest image (default 1024)" << std::endl
+                  << "  --max-size=[pixels]   : side of the largest image, up to 32768 (default 4096); the side"
+                  << std::endl << "                          doubles from the smallest to the largest" << std::endl
+                  << "  --shapes=[names]      : comma-separated shapes out of discs, spiral, coastline, blobs and"
+                  << std::endl << "                          glyphs (default all)" << std::endl
+                  << "  --repeat=[runs]       : runs of each stage, the fastest is reported (default 3)" << std::endl
+                  << "  --directory=[path]    : where the BMP files are written and loaded (default the temporary"
+                  << std::endl << "                          directory)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    BenchSettings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string setting = argv[i];
+        bool valid = true;
+        if (setting.starts_with("--min-size=")) {
+            valid = parseNumber(setting, settings.minSize) && settings.minSize > 0;
+        } else if (setting.starts_with("--max-size=")) {
+            valid = parseNumber(setting, settings.maxSize) && settings.maxSize <= 32768;
+        } else if (setting.starts_with("--shapes=")) {
+            valid = parseShapes(setting, settings.shapes);
+        } else if (setting.starts_with("--repeat=")) {
+            valid = parseNumber(setting, settings.repeat) && settings.repeat > 0;
+        } else if (setting.starts_with("--directory=")) {
+            settings.directory = setting.substr(setting.find('=') + 1);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cout << "Wrong arguments." << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    try {
+        ThreadPool pool;
+        for (SyntheticShape shape : settings.shapes) {
+            for (int size = settings.minSize; size <= settings.maxSize; size *= 2) {
+                benchImage(shape, size, settings, pool);
+            }
+        }
+    } catch (const MidCrackCodeError &error) {
+        std::cerr << error.what() << std::endl;
+        return error.getExitCode();
+    } catch (const std::exception &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
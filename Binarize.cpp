@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include "Binarize.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MID_CRACK_CODE_X86_KERNELS
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+//    a kernel processes the longest prefix of the row it can handle in whole blocks and returns its length in pixels;
+//    the rest of the row is processed by the scalar code
+    using LuminanceKernel = int (*)(const unsigned char *bgr, unsigned char *luminance, int width);
+    using BinarizeKernel = int (*)(const unsigned char *bgr, unsigned char *bits, int width, int threshold);
+
+    struct Kernels {
+        const char *name;
+        LuminanceKernel luminance;
+        BinarizeKernel binarize;
+    };
+
+    inline unsigned char luminanceOf(const unsigned char *bgr) {
+        return (unsigned char) ((77 * bgr[2] + 150 * bgr[1] + 29 * bgr[0] + 128) >> 8);
+    }
+
+//    reverse the order of the bits of every byte of a word, which turns 8 bytes of pixels with the first pixel in the
+//    highest bit into a word of a Bitmap row and back
+    inline Bitmap::Word reverseBitsOfBytes(Bitmap::Word word) {
+        word = (word >> 1 & 0x5555555555555555) | (word & 0x5555555555555555) << 1;
+        word = (word >> 2 & 0x3333333333333333) | (word & 0x3333333333333333) << 2;
+        return (word >> 4 & 0x0f0f0f0f0f0f0f0f) | (word & 0x0f0f0f0f0f0f0f0f) << 4;
+    }
+
+    int computeLuminanceScalar(const unsigned char *, unsigned char *, int) {
+        return 0;
+    }
+
+    int binarizeScalar(const unsigned char *, unsigned char *, int, int) {
+        return 0;
+    }
+
+#ifdef MID_CRACK_CODE_X86_KERNELS
+
+//    masks for pshufb that gather one channel of 16 pixels (48 bytes) from one of the three 16 byte parts;
+//    bytes of other parts are zeroed (high bit set)
+    constexpr std::array<char, 16> makeShuffleMask(int channel, int part) {
+        std::array<char, 16> mask{};
+        for (int i = 0; i < 16; ++i) {
+            const int byte = 3 * i + channel;
+            mask[i] = byte / 16 == part ? (char) (byte % 16) : (char) -128;
+        }
+        return mask;
+    }
+
+    constexpr std::array<std::array<char, 16>, 3> shuffleMasks[3] = {
+            {makeShuffleMask(0, 0), makeShuffleMask(0, 1), makeShuffleMask(0, 2)}, // blue
+            {makeShuffleMask(1, 0), makeShuffleMask(1, 1), makeShuffleMask(1, 2)}, // green
+            {makeShuffleMask(2, 0), makeShuffleMask(2, 1), makeShuffleMask(2, 2)}, // red
+    };
+
+    __attribute__((target("ssse3")))
+    inline __m128i weightChannels(__m128i b, __m128i g, __m128i r) {
+        const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(77)),
+                                                        _mm_mullo_epi16(g, _mm_set1_epi16(150))),
+                                          _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(29)),
+                                                        _mm_set1_epi16(128)));
+        return _mm_srli_epi16(sum, 8);
+    }
+
+//    luminance of 16 pixels
+    __attribute__((target("ssse3")))
+    inline __m128i luminance16(const unsigned char *bgr) {
+        const __m128i part[3] = {_mm_loadu_si128((const __m128i *) bgr),
+                                 _mm_loadu_si128((const __m128i *) (bgr + 16)),
+                                 _mm_loadu_si128((const __m128i *) (bgr + 32))};
+        __m128i channel[3];
+        for (int c = 0; c < 3; ++c) {
+            channel[c] = _mm_setzero_si128();
+            for (int p = 0; p < 3; ++p) {
+                const __m128i mask = _mm_loadu_si128((const __m128i *) shuffleMasks[c][p].data());
+                channel[c] = _mm_or_si128(channel[c], _mm_shuffle_epi8(part[p], mask));
+            }
+        }
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i low = weightChannels(_mm_unpacklo_epi8(channel[0], zero), _mm_unpacklo_epi8(channel[1], zero),
+                                           _mm_unpacklo_epi8(channel[2], zero));
+        const __m128i high = weightChannels(_mm_unpackhi_epi8(channel[0], zero), _mm_unpackhi_epi8(channel[1], zero),
+                                            _mm_unpackhi_epi8(channel[2], zero));
+        return _mm_packus_epi16(low, high);
+    }
+
+    __attribute__((target("ssse3")))
+    int computeLuminanceSsse3(const unsigned char *bgr, unsigned char *luminance, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            _mm_storeu_si128((__m128i *) (luminance + x), luminance16(bgr + 3 * x));
+        }
+        return x;
+    }
+
+    __attribute__((target("ssse3")))
+    int binarizeSsse3(const unsigned char *bgr, unsigned char *bits, int width, int threshold) {
+        const __m128i limit = _mm_set1_epi8((char) (threshold - 1));
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const __m128i luminance = luminance16(bgr + 3 * x);
+//            luminance < threshold <=> min(luminance, threshold - 1) == luminance
+            const __m128i black = _mm_cmpeq_epi8(_mm_min_epu8(luminance, limit), luminance);
+            const auto mask = (std::uint16_t) _mm_movemask_epi8(black);
+            std::memcpy(bits + x / 8, &mask, sizeof(mask));
+        }
+        return x;
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i loadLanes(const unsigned char *low, const unsigned char *high) {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) low)),
+                                       _mm_loadu_si128((const __m128i *) high), 1);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i weightChannels(__m256i b, __m256i g, __m256i r) {
+        const __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(77)),
+                                                              _mm256_mullo_epi16(g, _mm256_set1_epi16(150))),
+                                             _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(29)),
+                                                              _mm256_set1_epi16(128)));
+        return _mm256_srli_epi16(sum, 8);
+    }
+
+//    luminance of 32 pixels; each 128-bit lane handles 16 consecutive pixels like luminance16, so the result is in
+//    pixel order
+    __attribute__((target("avx2")))
+    inline __m256i luminance32(const unsigned char *bgr) {
+        const __m256i part[3] = {loadLanes(bgr, bgr + 48), loadLanes(bgr + 16, bgr + 64),
+                                 loadLanes(bgr + 32, bgr + 80)};
+        __m256i channel[3];
+        for (int c = 0; c < 3; ++c) {
+            channel[c] = _mm256_setzero_si256();
+            for (int p = 0; p < 3; ++p) {
+                const __m256i mask = _mm256_broadcastsi128_si256(
+                        _mm_loadu_si128((const __m128i *) shuffleMasks[c][p].data()));
+                channel[c] = _mm256_or_si256(channel[c], _mm256_shuffle_epi8(part[p], mask));
+            }
+        }
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i low = weightChannels(_mm256_unpacklo_epi8(channel[0], zero),
+                                           _mm256_unpacklo_epi8(channel[1], zero),
+                                           _mm256_unpacklo_epi8(channel[2], zero));
+        const __m256i high = weightChannels(_mm256_unpackhi_epi8(channel[0], zero),
+                                            _mm256_unpackhi_epi8(channel[1], zero),
+                                            _mm256_unpackhi_epi8(channel[2], zero));
+        return _mm256_packus_epi16(low, high);
+    }
+
+    __attribute__((target("avx2")))
+    int computeLuminanceAvx2(const unsigned char *bgr, unsigned char *luminance, int width) {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            _mm256_storeu_si256((__m256i *) (luminance + x), luminance32(bgr + 3 * x));
+        }
+        return x;
+    }
+
+    __attribute__((target("avx2")))
+    int binarizeAvx2(const unsigned char *bgr, unsigned char *bits, int width, int threshold) {
+        const __m256i limit = _mm256_set1_epi8((char) (threshold - 1));
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            const __m256i luminance = luminance32(bgr + 3 * x);
+            const __m256i black = _mm256_cmpeq_epi8(_mm256_min_epu8(luminance, limit), luminance);
+            const auto mask = (std::uint32_t) _mm256_movemask_epi8(black);
+            std::memcpy(bits + x / 8, &mask, sizeof(mask));
+        }
+        return x;
+    }
+
+#endif
+
+    Kernels selectKernels() {
+#ifdef MID_CRACK_CODE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return {"avx2", computeLuminanceAvx2, binarizeAvx2};
+        if (__builtin_cpu_supports("ssse3")) return {"ssse3", computeLuminanceSsse3, binarizeSsse3};
+#endif
+        return {"scalar", computeLuminanceScalar, binarizeScalar};
+    }
+
+    const Kernels &getKernels() {
+        static const Kernels kernels = selectKernels();
+        return kernels;
+    }
+}
+
+void computeLuminanceRow(const unsigned char *bgr, unsigned char *luminance, int width) {
+    for (int x = getKernels().luminance(bgr, luminance, width); x < width; ++x) {
+        luminance[x] = luminanceOf(bgr + 3 * x);
+    }
+}
+
+void binarizeRow(const unsigned char *bgr, Bitmap::Word *bits, int width, int threshold) {
+    const int words = (width + Bitmap::bitsPerWord - 1) / Bitmap::bitsPerWord;
+    std::memset(bits, 0, words * sizeof(Bitmap::Word));
+    if (threshold <= 0) return; // no pixel is darker than 0
+
+//    the vector kernels store their masks byte by byte, which matches the bit order of the words on little-endian
+//    processors only (the only ones they are built for)
+    int x = getKernels().binarize(bgr, reinterpret_cast<unsigned char *>(bits), width, threshold);
+    for (; x < width; ++x) {
+        if (luminanceOf(bgr + 3 * x) < threshold) {
+            bits[x / Bitmap::bitsPerWord] |= Bitmap::Word(1) << (x % Bitmap::bitsPerWord);
+        }
+    }
+}
+
+void addRowToHistogram(const unsigned char *bgr, int width, std::uint64_t histogram[256], unsigned char *scratch) {
+    computeLuminanceRow(bgr, scratch, width);
+
+//    count into separate histograms so that increments of the same bin do not wait on each other
+    std::uint32_t counts[4][256] = {};
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        counts[0][scratch[x]]++;
+        counts[1][scratch[x + 1]]++;
+        counts[2][scratch[x + 2]]++;
+        counts[3][scratch[x + 3]]++;
+    }
+    for (; x < width; ++x) counts[0][scratch[x]]++;
+    for (int i = 0; i < 256; ++i) {
+        histogram[i] += (std::uint64_t) counts[0][i] + counts[1][i] + counts[2][i] + counts[3][i];
+    }
+}
+
+int computeOtsuThreshold(const std::uint64_t histogram[256]) {
+    double total = 0, weightedTotal = 0;
+    for (int i = 0; i < 256; ++i) {
+        total += (double) histogram[i];
+        weightedTotal += (double) i * (double) histogram[i];
+    }
+
+//    find the luminance t that maximizes the between-class variance of classes [0, t] and [t + 1, 255]
+    double backgroundWeight = 0, backgroundSum = 0, bestVariance = -1;
+    int best = 0;
+    for (int t = 0; t < 256; ++t) {
+        backgroundWeight += (double) histogram[t];
+        backgroundSum += (double) t * (double) histogram[t];
+        const double foregroundWeight = total - backgroundWeight;
+        if (backgroundWeight == 0 || foregroundWeight == 0) continue;
+        const double meanDifference = backgroundSum / backgroundWeight -
+                                      (weightedTotal - backgroundSum) / foregroundWeight;
+        const double variance = backgroundWeight * foregroundWeight * meanDifference * meanDifference;
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            best = t;
+        }
+    }
+    return best + 1; // luminance t is still black
+}
+
+void binarizeIndexedRow(const unsigned char *indices, Bitmap::Word *bits, int width, const bool black[256]) {
+    const int words = (width + Bitmap::bitsPerWord - 1) / Bitmap::bitsPerWord;
+    std::memset(bits, 0, words * sizeof(Bitmap::Word));
+//    a byte of 8 pixels at a time, which matches the bit order of the words on little-endian processors
+    auto *bytes = reinterpret_cast<unsigned char *>(bits);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const unsigned char *pixel = indices + x;
+        bytes[x / 8] = (unsigned char) (black[pixel[0]] | black[pixel[1]] << 1 | black[pixel[2]] << 2 |
+                                        black[pixel[3]] << 3 | black[pixel[4]] << 4 | black[pixel[5]] << 5 |
+                                        black[pixel[6]] << 6 | black[pixel[7]] << 7);
+    }
+    for (; x < width; ++x) bytes[x / 8] |= (unsigned char) (black[indices[x]] << (x % 8));
+}
+
+void addIndexedRowToHistogram(const unsigned char *indices, int width, std::uint64_t counts[256]) {
+    for (int x = 0; x < width; ++x) counts[indices[x]]++;
+}
+
+void unpackMonochromeRow(const unsigned char *bytes, Bitmap::Word *bits, int width, bool invert) {
+//    the words are little-endian, so the first byte of the row is the lowest byte of the word
+    const int numberOfBytes = (width + 7) / 8;
+    const Bitmap::Word flip = invert ? ~Bitmap::Word(0) : 0;
+    for (int byte = 0; byte < numberOfBytes; byte += 8) {
+        Bitmap::Word word = 0;
+        std::memcpy(&word, bytes + byte, std::min(8, numberOfBytes - byte));
+        bits[byte / 8] = reverseBitsOfBytes(word) ^ flip;
+    }
+    if (width % Bitmap::bitsPerWord != 0) { // clear the bits past the width
+        bits[width / Bitmap::bitsPerWord] &= (Bitmap::Word(1) << (width % Bitmap::bitsPerWord)) - 1;
+    }
+}
+
+void packMonochromeRow(const Bitmap::Word *bits, unsigned char *bytes, int width) {
+    const int numberOfBytes = (width + 7) / 8;
+    for (int byte = 0; byte < numberOfBytes; byte += 8) {
+        const Bitmap::Word word = reverseBitsOfBytes(bits[byte / 8]);
+        std::memcpy(bytes + byte, &word, std::min(8, numberOfBytes - byte));
+    }
+}
+
+int countMonochromeRow(const unsigned char *bytes, int width) {
+    int count = 0;
+    for (int x = 0; x + 8 <= width; x += 8) count += std::popcount(bytes[x / 8]);
+    if (width % 8 != 0) count += std::popcount((unsigned char) (bytes[width / 8] >> (8 - width % 8)));
+    return count;
+}
+
+const char *getBinarizationKernelName() {
+    return getKernels().name;
+}
@@ -0,0 +1,60 @@
+#ifndef MID_CRACK_CODE_BINARIZE_H
+#define MID_CRACK_CODE_BINARIZE_H
+
+#include <cstdint>
+#include "Bitmap.h"
+
+// Kernels for converting rows of 24-bit BGR pixels (as stored in .bmp files) into binary pixels, and rows of palette
+// indices and of packed 1-bit pixels to and from binary pixels.
+// The luminance of a pixel is (77 r + 150 g + 29 b + 128) / 256 and a pixel is black when its luminance is below the
+// threshold. The SSSE3 and AVX2 versions of the kernels are chosen at runtime when the processor supports them.
+
+/// Default luminance threshold (pixels darker than mid-gray are black).
+const int defaultThreshold = 128;
+/// Threshold value that selects a threshold computed with Otsu's method.
+const int otsuThreshold = -1;
+
+/// Compute the luminance of each pixel in a row.
+/// \param bgr Pixels of the row, 3 bytes per pixel in blue, green, red order.
+/// \param luminance Output, one byte per pixel.
+void computeLuminanceRow(const unsigned char *bgr, unsigned char *luminance, int width);
+
+/// Binarize a row of pixels and pack the result into a row of a Bitmap (1 is black).
+/// \param bgr Pixels of the row, 3 bytes per pixel in blue, green, red order.
+/// \param bits Row of a Bitmap that is at least width bits long. Words that the row covers are overwritten.
+/// \param threshold Pixels with luminance below the threshold (0 to 256) are black.
+void binarizeRow(const unsigned char *bgr, Bitmap::Word *bits, int width, int threshold);
+
+/// Add the luminance of each pixel in a row to a histogram.
+/// \param scratch Buffer of at least width bytes.
+void addRowToHistogram(const unsigned char *bgr, int width, std::uint64_t histogram[256], unsigned char *scratch);
+
+/// Compute the threshold that maximizes the between-class variance of a luminance histogram (Otsu's method).
+/// \return Threshold for binarizeRow.
+int computeOtsuThreshold(const std::uint64_t histogram[256]);
+
+/// Binarize a row of 8-bit palette indices and pack the result into a row of a Bitmap.
+/// \param black black[i] is true if the color i of the palette is black.
+void binarizeIndexedRow(const unsigned char *indices, Bitmap::Word *bits, int width, const bool black[256]);
+
+/// Add the number of pixels of each palette index in a row of 8-bit indices to counts.
+void addIndexedRowToHistogram(const unsigned char *indices, int width, std::uint64_t counts[256]);
+
+/// Copy a row of 1-bit pixels packed 8 to a byte, first pixel in the highest bit (as in 1-bit .bmp and .pbm files),
+/// into a row of a Bitmap, 8 bytes at a time.
+/// \param invert Pixels that are 0 in bytes are black instead of those that are 1.
+void unpackMonochromeRow(const unsigned char *bytes, Bitmap::Word *bits, int width, bool invert);
+
+/// Copy a row of a Bitmap into 1-bit pixels packed like unpackMonochromeRow reads them, 1 is black. The bits of the
+/// last byte past the width are 0.
+/// \param bytes At least (width + 7) / 8 bytes.
+void packMonochromeRow(const Bitmap::Word *bits, unsigned char *bytes, int width);
+
+/// \return Number of pixels that are 1 in a row of packed 1-bit pixels.
+int countMonochromeRow(const unsigned char *bytes, int width);
+
+/// Name of the kernel selected for this processor ("avx2", "ssse3" or "scalar").
+const char *getBinarizationKernelName();
+
+
+#endif //MID_CRACK_CODE_BINARIZE_H
@@ -0,0 +1,63 @@
+#ifndef MID_CRACK_CODE_BITSTREAM_H
+#define MID_CRACK_CODE_BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Writes values of up to 32 bits into a byte buffer, least significant bit first.
+class BitWriter {
+private:
+    std::vector<unsigned char> &bytes;
+    std::uint64_t buffer{}; // bits not yet written to bytes
+    int bufferedBits{};
+
+public:
+    explicit BitWriter(std::vector<unsigned char> &bytes) : bytes(bytes) {}
+
+    void write(std::uint32_t value, int width) {
+        buffer |= (std::uint64_t) value << bufferedBits;
+        bufferedBits += width;
+        while (bufferedBits >= 8) {
+            bytes.push_back((unsigned char) buffer);
+            buffer >>= 8;
+            bufferedBits -= 8;
+        }
+    }
+
+    /// Write the remaining bits, padding the last byte with zeros.
+    void flush() {
+        if (bufferedBits > 0) bytes.push_back((unsigned char) buffer);
+        buffer = 0;
+        bufferedBits = 0;
+    }
+};
+
+/// Reads values written by BitWriter.
+class BitReader {
+private:
+    const unsigned char *bytes;
+    std::size_t size;
+    std::size_t position{}; // next byte to move into the buffer
+    std::uint64_t buffer{};
+    int bufferedBits{};
+
+public:
+    BitReader(const unsigned char *bytes, std::size_t size) : bytes(bytes), size(size) {}
+
+    /// \return False if there are not enough bits left.
+    bool read(std::uint32_t &value, int width) {
+        while (bufferedBits < width) {
+            if (position == size) return false;
+            buffer |= (std::uint64_t) bytes[position++] << bufferedBits;
+            bufferedBits += 8;
+        }
+        value = (std::uint32_t) (buffer & ((std::uint64_t(1) << width) - 1));
+        buffer >>= width;
+        bufferedBits -= width;
+        return true;
+    }
+};
+
+
+#endif //MID_CRACK_CODE_BITSTREAM_H
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include "Bitmap.h"
+
+Bitmap::Bitmap() = default;
+
+Bitmap::Bitmap(int width, int height)
+        : width(width), height(height), wordsPerRow(width / bitsPerWord + 1),
+          words(wordsPerRow * (height + 2) + 2, 0) {} // with the rows and words of the border
+
+Bitmap::Bitmap(Bitmap &&other) noexcept
+        : width(std::exchange(other.width, 0)), height(std::exchange(other.height, 0)),
+          wordsPerRow(std::exchange(other.wordsPerRow, 0)), words(std::move(other.words)) {}
+
+Bitmap &Bitmap::operator=(Bitmap &&other) noexcept {
+    width = std::exchange(other.width, 0);
+    height = std::exchange(other.height, 0);
+    wordsPerRow = std::exchange(other.wordsPerRow, 0);
+    words = std::move(other.words);
+    return *this;
+}
+
+void Bitmap::setRun(int y, int x0, int x1) {
+    if (x0 >= x1) return;
+    Word *row = getRow(y);
+    const std::size_t first = x0 / bitsPerWord, last = (x1 - 1) / bitsPerWord;
+    const Word firstMask = ~Word(0) << (x0 % bitsPerWord);
+    const Word lastMask = ~Word(0) >> (bitsPerWord - 1 - (x1 - 1) % bitsPerWord);
+    if (first == last) {
+        row[first] |= firstMask & lastMask;
+        return;
+    }
+    row[first] |= firstMask;
+    std::fill(row + first + 1, row + last, ~Word(0));
+    row[last] |= lastMask;
+}
+
+int Bitmap::findInRow(int y, int x, bool black) const {
+    if (x >= width) return width;
+    const Word *row = getRow(y);
+    const Word flip = black ? 0 : ~Word(0); // search for set bits in the complement when looking for white pixels
+    std::size_t i = x / bitsPerWord;
+    Word word = (row[i] ^ flip) & (~Word(0) << (x % bitsPerWord));
+    while (word == 0) {
+        if (++i == wordsPerRow) return width;
+        word = row[i] ^ flip;
+    }
+//    the complement of the bits past the width is set, so a white pixel found there means there is none
+    return std::min(width, (int) (i * bitsPerWord) + std::countr_zero(word));
+}
+
+bool Bitmap::findFirstSet(int &x, int &y) const {
+//    bits past the width and the border are 0, so the rows can be scanned as one block of words
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        if (words[i] != 0) {
+            y = (int) ((i - 1) / wordsPerRow) - 1;
+            x = (int) ((i - 1) % wordsPerRow) * bitsPerWord + std::countr_zero(words[i]);
+            return true;
+        }
+    }
+    return false;
+}
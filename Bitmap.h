@@ -0,0 +1,103 @@
+#ifndef MID_CRACK_CODE_BITMAP_H
+#define MID_CRACK_CODE_BITMAP_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// Binary image stored with one bit per pixel (0 is white, 1 is black).
+/// Pixels are kept in one contiguous block; every row starts on a word boundary and the bit of pixel x is bit
+/// (x % 64) of word (x / 64) of its row. Bits past the width of the image are always 0.
+/// The image has a border of white pixels that are never set: every row has at least one bit past the width, which
+/// is also the pixel left of the next row, and there is a white row above the first row and below the last one, with
+/// a word before and after them. So the neighbours of every pixel can be read without checking the bounds.
+class Bitmap {
+public:
+    using Word = std::uint64_t;
+    static const int bitsPerWord = 64;
+
+private:
+    int width{};
+    int height{};
+    std::size_t wordsPerRow{};
+    std::vector<Word> words;
+
+public:
+    Bitmap();
+
+    /// Create a white bitmap.
+    Bitmap(int width, int height);
+
+    Bitmap(Bitmap &&other) noexcept;
+
+    Bitmap &operator=(Bitmap &&other) noexcept;
+
+    Bitmap(const Bitmap &) = delete;
+
+    Bitmap &operator=(const Bitmap &) = delete;
+
+    [[nodiscard]] int getWidth() const { return width; }
+
+    [[nodiscard]] int getHeight() const { return height; }
+
+    [[nodiscard]] std::size_t getWordsPerRow() const { return wordsPerRow; }
+
+    /// \param y Row from -1 (the white row above the image) to the height (the white row below).
+    [[nodiscard]] Word *getRow(int y) { return words.data() + 1 + (y + 1) * wordsPerRow; }
+
+    [[nodiscard]] const Word *getRow(int y) const { return words.data() + 1 + (y + 1) * wordsPerRow; }
+
+    [[nodiscard]] bool get(int x, int y) const {
+        return (getRow(y)[x / bitsPerWord] >> (x % bitsPerWord)) & 1;
+    }
+
+    /// Number of bits from a pixel to the pixel below it.
+    [[nodiscard]] std::ptrdiff_t getBitsPerRow() const { return (std::ptrdiff_t) (wordsPerRow * bitsPerWord); }
+
+    /// Position of the 3x3 pixels around a pixel for getNeighbourhood; moving to another pixel adds dx + dy *
+    /// getBitsPerRow() to it.
+    /// \param x, y Any pixel of the image.
+    [[nodiscard]] std::size_t getNeighbourhoodPosition(int x, int y) const {
+        return (1 + (std::size_t) y * wordsPerRow) * bitsPerWord + x - 1; // bit of the pixel (x - 1, y - 1)
+    }
+
+    /// Get the 3x3 pixels around a pixel as 9 bits: bit (dy + 1) * 3 + (dx + 1) is the pixel (x + dx, y + dy).
+    /// The white border around the image makes it safe for every pixel of the image.
+    [[nodiscard]] unsigned getNeighbourhood(std::size_t position) const {
+//        the bits are read with unaligned 2-byte loads: the words are little-endian, and the three bits of a row start
+//        at the same offset in all rows, as every row has a whole number of words
+        static_assert(std::endian::native == std::endian::little);
+        const auto *bytes = reinterpret_cast<const unsigned char *>(words.data()) + position / 8;
+        const std::size_t bytesPerRow = wordsPerRow * sizeof(Word);
+        const int offset = (int) (position % 8);
+        std::uint16_t above, middle, below;
+        std::memcpy(&above, bytes, sizeof(above));
+        std::memcpy(&middle, bytes + bytesPerRow, sizeof(middle));
+        std::memcpy(&below, bytes + 2 * bytesPerRow, sizeof(below));
+        return (above >> offset & 7) | (middle >> offset & 7) << 3 | (below >> offset & 7) << 6;
+    }
+
+    void set(int x, int y) {
+        getRow(y)[x / bitsPerWord] |= Word(1) << (x % bitsPerWord);
+    }
+
+    void reset(int x, int y) {
+        getRow(y)[x / bitsPerWord] &= ~(Word(1) << (x % bitsPerWord));
+    }
+
+    /// Set the pixels [x0, x1) of a row, a whole word at a time.
+    void setRun(int y, int x0, int x1);
+
+    /// Find the first pixel of the given color in a row, starting at x, by looking at whole words at a time.
+    /// \return Width of the bitmap if there is no such pixel.
+    [[nodiscard]] int findInRow(int y, int x, bool black) const;
+
+    /// Find the first black pixel in row-major order, skipping whole white words at a time.
+    /// \return False if the bitmap has no black pixels.
+    bool findFirstSet(int &x, int &y) const;
+};
+
+
+#endif //MID_CRACK_CODE_BITMAP_H
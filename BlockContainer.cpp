@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "BlockContainer.h"
+#include "Error.h"
+#include "Stats.h"
+
+namespace {
+//    larger blocks grow while their digits are appended, so a huge block size does not reserve its memory up front
+    const std::size_t maxReservedSymbols = std::size_t(1) << 20;
+
+    void writeNumber(std::vector<unsigned char> &bytes, std::uint64_t value, int size) {
+        for (int byte = 0; byte < size; ++byte) bytes.push_back((unsigned char) (value >> (8 * byte)));
+    }
+
+    /// Reads little-endian numbers and remembers if it tried to read past the end.
+    class NumberReader {
+    private:
+        const unsigned char *bytes;
+        std::size_t size;
+        std::size_t position;
+
+    public:
+        bool valid = true;
+
+        NumberReader(const unsigned char *bytes, std::size_t size, std::size_t position)
+                : bytes(bytes), size(size), position(position) {}
+
+        std::uint64_t read(int numberSize) {
+            if (position > size || size - position < (std::size_t) numberSize) {
+                valid = false;
+                return 0;
+            }
+            std::uint64_t value = 0;
+            for (int byte = 0; byte < numberSize; ++byte) value |= std::uint64_t(bytes[position++]) << (8 * byte);
+            return value;
+        }
+    };
+}
+
+BlockContainerWriter::BlockContainerWriter(std::ostream &output, const CompressionSettings &settings, ThreadPool &pool,
+                                           int imageWidth, int imageHeight)
+        : output(output), settings(settings), codec(createBlockCodec(settings)), pool(pool) {
+    container.layout.imageWidth = imageWidth;
+    container.layout.imageHeight = imageHeight;
+    block.reserve(std::min<std::size_t>(settings.symbolsPerBlock, maxReservedSymbols));
+
+//    header
+    std::vector<unsigned char> bytes(compressedMagic, compressedMagic + 3);
+    const bool dictionary = settings.codec == CodecType::lzw && settings.dictionary;
+    bytes.push_back(dictionary ? dictionaryContainerVersion : blockContainerVersion);
+    bytes.push_back((unsigned char) settings.maxCodeWidth);
+    bytes.push_back(settings.resetWhenFull ? 0 : 1);
+    bytes.push_back((unsigned char) settings.codec);
+    bytes.push_back(settings.codec == CodecType::turns ? (unsigned char) settings.contextOrder : 0);
+    writeNumber(bytes, settings.symbolsPerBlock, 4);
+    if (dictionary) writeNumber(bytes, settings.dictionary->getId(), 4);
+    write(bytes);
+}
+
+void BlockContainerWriter::write(const std::vector<unsigned char> &bytes) {
+    output.write((const char *) bytes.data(), (std::streamsize) bytes.size());
+    bytesWritten += bytes.size();
+}
+
+void BlockContainerWriter::startChain(int startX, int startY, int startDirection) {
+    container.layout.chains.push_back({startX, startY, startDirection, {}});
+    container.chainLengths.push_back(0);
+}
+
+void BlockContainerWriter::append(const ChainCode &code) {
+    for (std::size_t i = 0; i < code.size();) {
+        const std::size_t count = std::min(code.size() - i, settings.symbolsPerBlock - block.size());
+        block.append(code, i, count);
+        container.chainLengths.back() += count;
+        i += count;
+        if (block.size() == settings.symbolsPerBlock) compressBlock();
+    }
+}
+
+void BlockContainerWriter::setImageOfChain(int imageWidth, int imageHeight, int startX, int startY) {
+    container.layout.imageWidth = imageWidth;
+    container.layout.imageHeight = imageHeight;
+    container.layout.chains.back().startX = startX;
+    container.layout.chains.back().startY = startY;
+}
+
+void BlockContainerWriter::compressBlock() {
+    container.blocks.push_back({0, container.numberOfSymbols});
+    container.numberOfSymbols += block.size();
+
+    auto task = std::make_shared<std::packaged_task<std::vector<unsigned char>()>>(
+            [digits = std::move(block), codec = codec] {
+                std::vector<unsigned char> bytes;
+                codec->encode(digits, 0, digits.size(), bytes);
+                return bytes;
+            });
+    compressedBlocks.push_back(task->get_future());
+    pool.submit([task] { (*task)(); });
+    block = ChainCode();
+    block.reserve(std::min<std::size_t>(settings.symbolsPerBlock, maxReservedSymbols));
+
+//    a few blocks per thread are compressed at the same time
+    while (compressedBlocks.size() > 2 * (std::size_t) pool.getNumberOfThreads()) writeOldestBlock();
+}
+
+void BlockContainerWriter::writeOldestBlock() {
+    const std::size_t blockIndex = container.blocks.size() - compressedBlocks.size();
+    container.blocks[blockIndex].byteOffset = bytesWritten;
+    write(compressedBlocks.front().get());
+    compressedBlocks.pop_front();
+}
+
+void BlockContainerWriter::finish() {
+    if (!block.empty()) compressBlock();
+    while (!compressedBlocks.empty()) writeOldestBlock();
+
+//    footer
+    std::vector<unsigned char> bytes;
+    const std::uint64_t footerOffset = bytesWritten;
+    writeNumber(bytes, (std::uint32_t) container.layout.imageWidth, 4);
+    writeNumber(bytes, (std::uint32_t) container.layout.imageHeight, 4);
+    writeNumber(bytes, container.layout.chains.size(), 4);
+    for (std::size_t i = 0; i < container.layout.chains.size(); ++i) {
+        const MidCrackChain &chain = container.layout.chains[i];
+        writeNumber(bytes, (std::uint32_t) chain.startX, 4);
+        writeNumber(bytes, (std::uint32_t) chain.startY, 4);
+        writeNumber(bytes, chain.startDirection, 1);
+        writeNumber(bytes, container.chainLengths[i], 8);
+    }
+    writeNumber(bytes, container.blocks.size(), 4);
+    for (const auto &compressedBlock : container.blocks) {
+        writeNumber(bytes, compressedBlock.byteOffset, 8);
+        writeNumber(bytes, compressedBlock.firstSymbol, 8);
+    }
+    writeNumber(bytes, container.numberOfSymbols, 8);
+    writeNumber(bytes, footerOffset, 8);
+    write(bytes);
+}
+
+bool isBlockContainer(std::span<const unsigned char> bytes) {
+    return bytes.size() >= 4 && std::equal(compressedMagic, compressedMagic + 3, bytes.begin()) &&
+           (bytes[3] == blockContainerVersion || bytes[3] == dictionaryContainerVersion);
+}
+
+bool readBlockContainer(std::span<const unsigned char> bytes, BlockContainer &container,
+                        const std::shared_ptr<const LzwDictionary> &dictionary) {
+    StageTimer timer(Stage::parseHeader);
+    if (!isBlockContainer(bytes)) return false;
+    const bool hasDictionary = bytes[3] == dictionaryContainerVersion;
+    container.headerSize = hasDictionary ? dictionaryContainerHeaderSize : blockContainerHeaderSize;
+    if (bytes.size() < container.headerSize + 8) return false;
+    container.data = bytes.data();
+
+//    header
+    NumberReader header(bytes.data(), bytes.size(), 4);
+    container.settings.maxCodeWidth = (int) header.read(1);
+    container.settings.resetWhenFull = header.read(1) == 0;
+    const auto codec = (std::uint8_t) header.read(1);
+    container.settings.codec = (CodecType) codec;
+    container.settings.contextOrder = (int) header.read(1);
+    container.settings.symbolsPerBlock = header.read(4);
+    if (container.settings.maxCodeWidth < lzwMinCodeWidth || container.settings.maxCodeWidth > lzwMaxCodeWidth ||
+        codec > (std::uint8_t) CodecType::turns || container.settings.contextOrder > turnsMaxContextOrder) {
+        return false;
+    }
+    container.settings.dictionary = nullptr;
+    if (hasDictionary) {
+        const std::uint64_t dictionaryId = header.read(4);
+        if (container.settings.codec != CodecType::lzw) return false;
+        if (!dictionary || dictionary->getId() != dictionaryId) {
+            std::ostringstream message;
+            message << "The compressed mid-crack code needs the LZW dictionary with ID " << std::hex
+                    << std::setfill('0') << std::setw(8) << dictionaryId << ".";
+            throw MidCrackCodeError(message.str());
+        }
+        container.settings.dictionary = dictionary;
+        if (!fitsLzwDictionary(container.settings)) return false;
+    }
+    container.codec = createBlockCodec(container.settings);
+
+//    footer
+    container.footerOffset = NumberReader(bytes.data(), bytes.size(), bytes.size() - 8).read(8);
+    if (container.footerOffset < container.headerSize || container.footerOffset > bytes.size() - 8) return false;
+    NumberReader footer(bytes.data(), bytes.size() - 8, container.footerOffset);
+    container.layout.imageWidth = (int) (std::uint32_t) footer.read(4);
+    container.layout.imageHeight = (int) (std::uint32_t) footer.read(4);
+    const std::uint64_t numberOfChains = footer.read(4);
+    container.layout.chains.clear();
+    container.chainLengths.clear();
+    std::uint64_t sumOfChainLengths = 0;
+    for (std::uint64_t i = 0; i < numberOfChains && footer.valid; ++i) {
+        MidCrackChain &chain = container.layout.chains.emplace_back();
+        chain.startX = (int) (std::uint32_t) footer.read(4);
+        chain.startY = (int) (std::uint32_t) footer.read(4);
+        chain.startDirection = (int) footer.read(1);
+        container.chainLengths.push_back(footer.read(8));
+        sumOfChainLengths += container.chainLengths.back();
+        if (chain.startDirection % 2 != 0 || chain.startDirection > 6) return false;
+    }
+    const std::uint64_t numberOfBlocks = footer.read(4);
+    container.blocks.clear();
+    for (std::uint64_t i = 0; i < numberOfBlocks && footer.valid; ++i) {
+        CompressedBlock &block = container.blocks.emplace_back();
+        block.byteOffset = footer.read(8);
+        block.firstSymbol = footer.read(8);
+    }
+    container.numberOfSymbols = footer.read(8);
+    if (!footer.valid || sumOfChainLengths != container.numberOfSymbols) return false;
+//    with every length at most the sum, the sum cannot have wrapped around
+    for (std::uint64_t chainLength : container.chainLengths) {
+        if (chainLength > container.numberOfSymbols) return false;
+    }
+
+//    the blocks have to be in order, cover all the digits and not have more digits than fit in a block or in their
+//    compressed bytes, so a corrupted footer cannot make the decompression allocate a lot of memory
+    for (std::size_t i = 0; i < container.blocks.size(); ++i) {
+        const CompressedBlock &block = container.blocks[i];
+        const std::uint64_t blockEnd = i + 1 < container.blocks.size() ? container.blocks[i + 1].byteOffset
+                                                                       : container.footerOffset;
+        const std::uint64_t previousSymbol = i == 0 ? 0 : container.blocks[i - 1].firstSymbol + 1;
+        if (block.byteOffset < container.headerSize || block.byteOffset > blockEnd ||
+            block.firstSymbol < previousSymbol || block.firstSymbol >= container.numberOfSymbols ||
+            (i == 0 && block.firstSymbol != 0)) {
+            return false;
+        }
+        const std::uint64_t symbolEnd = i + 1 < container.blocks.size() ? container.blocks[i + 1].firstSymbol
+                                                                        : container.numberOfSymbols;
+        const std::uint64_t numberOfBlockSymbols = symbolEnd - block.firstSymbol;
+        if (numberOfBlockSymbols > container.settings.symbolsPerBlock ||
+            numberOfBlockSymbols > container.codec->getMaxDigits(blockEnd - block.byteOffset)) {
+            return false;
+        }
+    }
+    addStageBytes(Stage::parseHeader, container.headerSize + bytes.size() - container.footerOffset, 0);
+    return !container.blocks.empty() || container.numberOfSymbols == 0;
+}
+
+bool decompressBlocks(const BlockContainer &container, std::uint64_t firstSymbol, std::uint64_t count,
+                      ChainCode &digits, ThreadPool &pool) {
+    const std::uint64_t endSymbol = std::min(container.numberOfSymbols, firstSymbol + count);
+    if (firstSymbol >= endSymbol) return true;
+
+//    blocks that contain the first and the last digit
+    auto blockAfter = [&](std::uint64_t symbol) {
+        return (std::size_t) (std::upper_bound(container.blocks.begin(), container.blocks.end(), symbol,
+                                               [](std::uint64_t s, const CompressedBlock &block) {
+                                                   return s < block.firstSymbol;
+                                               }) - container.blocks.begin());
+    };
+    const std::size_t firstBlock = blockAfter(firstSymbol) - 1;
+    const std::size_t endBlock = blockAfter(endSymbol - 1);
+
+//    decompress the blocks in parallel, one digit per byte, and pack the requested digits of each block
+    std::vector<ChainCode> decompressedBlocks(endBlock - firstBlock);
+    std::vector<char> blockIsValid(decompressedBlocks.size());
+    pool.parallelFor(decompressedBlocks.size(), [&](std::size_t i) {
+        const std::size_t block = firstBlock + i;
+        const std::uint64_t byteEnd = block + 1 < container.blocks.size() ? container.blocks[block + 1].byteOffset
+                                                                          : container.footerOffset;
+        const std::uint64_t blockStart = container.blocks[block].firstSymbol;
+        const std::uint64_t blockEnd = block + 1 < container.blocks.size() ? container.blocks[block + 1].firstSymbol
+                                                                           : container.numberOfSymbols;
+        const std::uint64_t from = std::max(blockStart, firstSymbol), to = std::min(blockEnd, endSymbol);
+        std::vector<unsigned char> blockDigits(blockEnd - blockStart);
+        blockIsValid[i] = container.codec->decode(container.data + container.blocks[block].byteOffset,
+                                                  byteEnd - container.blocks[block].byteOffset, blockDigits.data(),
+                                                  blockDigits.size());
+        decompressedBlocks[i].append(blockDigits.data() + (from - blockStart), to - from);
+    });
+    if (std::find(blockIsValid.begin(), blockIsValid.end(), 0) != blockIsValid.end()) return false;
+
+//    join the blocks
+    digits.reserve(digits.size() + (endSymbol - firstSymbol));
+    for (const auto &blockDigits : decompressedBlocks) digits.append(blockDigits);
+    return true;
+}
+
+bool decompressMidCrackCodeBlocks(const BlockContainer &container, MidCrackCode &midCrackCode, ThreadPool &pool) {
+    ChainCode digits;
+    if (!decompressBlocks(container, 0, container.numberOfSymbols, digits, pool)) return false;
+
+//    split the digits into the chains
+    midCrackCode = container.layout;
+    std::size_t first = 0;
+    if (midCrackCode.chains.size() == 1) {
+        midCrackCode.chains[0].code = std::move(digits);
+        return true;
+    }
+    for (std::size_t i = 0; i < midCrackCode.chains.size(); ++i) {
+        midCrackCode.chains[i].code.append(digits, first, container.chainLengths[i]);
+        first += container.chainLengths[i];
+    }
+    return true;
+}
+
+bool decompressBlocksInOrder(const BlockContainer &container, ThreadPool &pool,
+                             const std::function<void(const unsigned char *digits, std::size_t count)> &useDigits) {
+    std::deque<std::future<std::vector<unsigned char>>> decompressedBlocks;
+    std::size_t nextBlock = 0;
+    while (nextBlock < container.blocks.size() || !decompressedBlocks.empty()) {
+//        keep a few blocks per thread decompressing
+        while (nextBlock < container.blocks.size() &&
+               decompressedBlocks.size() < 2 * (std::size_t) pool.getNumberOfThreads()) {
+            const std::size_t block = nextBlock++;
+            auto task = std::make_shared<std::packaged_task<std::vector<unsigned char>()>>([&container, block] {
+                const std::uint64_t byteEnd = block + 1 < container.blocks.size()
+                                              ? container.blocks[block + 1].byteOffset : container.footerOffset;
+                const std::uint64_t symbolEnd = block + 1 < container.blocks.size()
+                                                ? container.blocks[block + 1].firstSymbol : container.numberOfSymbols;
+                std::vector<unsigned char> digits(symbolEnd - container.blocks[block].firstSymbol);
+                if (!container.codec->decode(container.data + container.blocks[block].byteOffset,
+                                             byteEnd - container.blocks[block].byteOffset, digits.data(),
+                                             digits.size())) {
+                    digits.clear();
+                    digits.shrink_to_fit();
+                }
+                return digits;
+            });
+            decompressedBlocks.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+
+//        the tasks that are still running use the container, so they have to finish before returning
+        auto waitForBlocks = [&] {
+            while (!decompressedBlocks.empty()) {
+                decompressedBlocks.front().wait();
+                decompressedBlocks.pop_front();
+            }
+        };
+        std::vector<unsigned char> digits = decompressedBlocks.front().get();
+        decompressedBlocks.pop_front();
+        if (digits.empty()) { // every block has at least one digit
+            waitForBlocks();
+            return false;
+        }
+        try {
+            useDigits(digits.data(), digits.size());
+        } catch (...) {
+            waitForBlocks();
+            throw;
+        }
+    }
+    return true;
+}
+
+bool decompressMidCrackCode(std::span<const unsigned char> bytes, MidCrackCode &midCrackCode, ThreadPool &pool,
+                            const std::shared_ptr<const LzwDictionary> &dictionary) {
+    midCrackCode = MidCrackCode();
+    const bool variableWidth = bytes.size() >= 4 && std::equal(compressedMagic, compressedMagic + 3, bytes.begin());
+    if (isBlockContainer(bytes)) {
+        BlockContainer container;
+        return readBlockContainer(bytes, container, dictionary) &&
+               decompressMidCrackCodeBlocks(container, midCrackCode, pool);
+    }
+
+    StageTimer timer(Stage::decode);
+    addStageBytes(Stage::decode, bytes.size(), 0);
+    ChainCode &digits = midCrackCode.chains.emplace_back().code;
+    if (variableWidth) { // version 1: a single stream of variable width codes
+        const int maxCodeWidth = bytes.size() > 4 ? bytes[4] : 0;
+        const bool valid = bytes[3] == singleStreamVersion && bytes.size() >= singleStreamHeaderSize &&
+                           maxCodeWidth >= lzwMinCodeWidth && maxCodeWidth <= lzwMaxCodeWidth &&
+                           decodeLzwBits(bytes.data() + singleStreamHeaderSize, bytes.size() - singleStreamHeaderSize,
+                                         maxCodeWidth, digits);
+        addStageSymbols(Stage::decode, digits.size());
+        return valid;
+    }
+
+//    legacy format: number of bytes of each code, then the codes in little-endian order
+    const std::size_t numberOfBytesInCode = bytes.empty() ? 0 : bytes[0];
+    if (bytes.empty() || numberOfBytesInCode > sizeof(unsigned)) return false;
+    LzwDecoder decoder;
+    for (std::size_t i = 1; numberOfBytesInCode > 0 && i < bytes.size(); i += numberOfBytesInCode) {
+        if (i + numberOfBytesInCode > bytes.size()) return false;
+        unsigned code = 0;
+        for (std::size_t byte = 0; byte < numberOfBytesInCode; ++byte) {
+            code |= unsigned(bytes[i + byte]) << (8 * byte);
+        }
+        if (!decoder.addCode(code, digits)) return false;
+    }
+    addStageSymbols(Stage::decode, digits.size());
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef MID_CRACK_CODE_BLOCKCONTAINER_H
+#define MID_CRACK_CODE_BLOCKCONTAINER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+#include "Codec.h"
+#include "Lzw.h"
+#include "MidCrackChain.h"
+#include "ThreadPool.h"
+
+/// Start of every compressed mid-crack code with variable width codes, followed by the version.
+const unsigned char compressedMagic[3] = {'M', 'C', 'Z'};
+/// Version 1: a single LZW stream after a header of 6 bytes (magic, version, largest code width, full dictionary).
+const unsigned char singleStreamVersion = 1;
+const std::size_t singleStreamHeaderSize = 6;
+/// Version 2: block container.
+const unsigned char blockContainerVersion = 2;
+const std::size_t blockContainerHeaderSize = 12;
+/// Version 3: block container of LZW codes that start with the strings of an LzwDictionary, with the ID of the
+/// dictionary (uint32) after the header of version 2. Containers without a dictionary are still written as version 2.
+const unsigned char dictionaryContainerVersion = 3;
+const std::size_t dictionaryContainerHeaderSize = 16;
+
+/// Entry of the block index.
+struct CompressedBlock {
+    std::uint64_t byteOffset{}; // from the start of the file
+    std::uint64_t firstSymbol{}; // offset of the first digit of the block in the digits of all the chains
+};
+
+/// Compressed mid-crack code in the block container format:
+/// - header: magic, version 2, largest code width, full dictionary setting (0 reset, 1 freeze), codec (CodecType),
+///   context order of the range coder and the number of digits in each block (uint32), then with version 3 the ID of
+///   the LZW dictionary (uint32);
+/// - blocks: the digits of all the chains one after the other, split into blocks that are compressed independently with
+///   the codec;
+/// - footer: image width and height (int32), number of chains (uint32), startX, startY (int32), startDirection (uint8)
+///   and the number of digits (uint64) of each chain, number of blocks (uint32), the index entry of each block
+///   (2 x uint64) and the number of all the digits (uint64);
+/// - byte offset of the footer (uint64).
+/// All numbers are little-endian. The footer is at the end so the blocks can be written as they are compressed.
+struct BlockContainer {
+    CompressionSettings settings;
+    std::shared_ptr<const BlockCodec> codec;
+//    chains without their digits, the lengths are in chainLengths
+    MidCrackCode layout;
+    std::vector<std::uint64_t> chainLengths;
+    std::vector<CompressedBlock> blocks;
+    std::uint64_t numberOfSymbols{};
+    std::uint64_t headerSize{}; // start of the first block
+    std::uint64_t footerOffset{}; // end of the last block
+    const unsigned char *data{}; // whole file
+};
+
+/// Writes a block container while the chains are added digit by digit. Every full block is compressed by a task on the
+/// thread pool and the compressed blocks are written in order, so only a few blocks are kept in memory.
+class BlockContainerWriter final : public ChainCodeSink {
+private:
+    std::ostream &output;
+    CompressionSettings settings;
+    std::shared_ptr<const BlockCodec> codec;
+    ThreadPool &pool;
+    BlockContainer container; // index of the blocks and chains that are already added
+    ChainCode block; // digits of the block that is being filled
+    std::uint64_t bytesWritten{};
+//    blocks that are being compressed, from the oldest one
+    std::deque<std::future<std::vector<unsigned char>>> compressedBlocks;
+
+    void write(const std::vector<unsigned char> &bytes);
+
+    void compressBlock();
+
+    void writeOldestBlock();
+
+public:
+    /// Write the header of the container.
+    BlockContainerWriter(std::ostream &output, const CompressionSettings &settings, ThreadPool &pool, int imageWidth,
+                         int imageHeight);
+
+    /// Start the next chain; the digits that follow belong to it.
+    void startChain(int startX, int startY, int startDirection);
+
+    void push_back(int digit) override {
+        block.push_back(digit);
+        ++container.chainLengths.back();
+        if (block.size() == settings.symbolsPerBlock) compressBlock();
+    }
+
+    void append(const ChainCode &code);
+
+    /// Set the image size and the start of the current chain when they are only known after its digits.
+    void setImageOfChain(int imageWidth, int imageHeight, int startX, int startY);
+
+    /// Write the remaining blocks and the footer.
+    void finish();
+
+    /// \return Number of digits of all the chains, after finish.
+    [[nodiscard]] std::uint64_t getNumberOfSymbols() const { return container.numberOfSymbols; }
+};
+
+/// \return True if bytes start like a block container of any version.
+bool isBlockContainer(std::span<const unsigned char> bytes);
+
+/// Read the header and the footer of a block container.
+/// \param bytes Whole file; it has to outlive container.
+/// \param dictionary The LZW dictionary of a container of version 3; it is not used by the other versions.
+/// \return False if it is not a valid block container.
+/// \throw MidCrackCodeError If the container needs an LZW dictionary with another ID.
+bool readBlockContainer(std::span<const unsigned char> bytes, BlockContainer &container,
+                        const std::shared_ptr<const LzwDictionary> &dictionary = nullptr);
+
+/// Decompress the digits [firstSymbol, firstSymbol + count) of all the chains. Only the blocks that contain them are
+/// decompressed, in parallel.
+/// \return False if the blocks are corrupted.
+bool decompressBlocks(const BlockContainer &container, std::uint64_t firstSymbol, std::uint64_t count,
+                      ChainCode &digits, ThreadPool &pool);
+
+/// Decompress all the chains of a block container.
+/// \return False if the blocks are corrupted.
+bool decompressMidCrackCodeBlocks(const BlockContainer &container, MidCrackCode &midCrackCode, ThreadPool &pool);
+
+/// Decompress all the blocks in order and pass the digits of each block (one digit per byte) to useDigits. The next
+/// blocks are decompressed on the thread pool while useDigits runs, so only a few blocks are kept in memory.
+/// An exception thrown by useDigits is passed on once the blocks that are being decompressed are finished.
+/// \return False if the blocks are corrupted.
+bool decompressBlocksInOrder(const BlockContainer &container, ThreadPool &pool,
+                             const std::function<void(const unsigned char *digits, std::size_t count)> &useDigits);
+
+/// Decompress a whole compressed mid-crack code in any of the formats (block container, version 1 or legacy).
+/// \param dictionary The LZW dictionary of a block container of version 3.
+/// \return False if it is corrupted.
+/// \throw MidCrackCodeError If it needs an LZW dictionary with another ID.
+bool decompressMidCrackCode(std::span<const unsigned char> bytes, MidCrackCode &midCrackCode, ThreadPool &pool,
+                            const std::shared_ptr<const LzwDictionary> &dictionary = nullptr);
+
+
+#endif //MID_CRACK_CODE_BLOCKCONTAINER_H
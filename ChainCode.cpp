@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "ChainCode.h"
+
+ChainCode::ChainCode(std::string_view digits) {
+    reserve(digits.size());
+    std::size_t i = 0;
+    for (; i + digitsPerWord <= digits.size(); i += digitsPerWord) {
+        Word packedDigits = 0;
+        for (int digit = 0; digit < digitsPerWord; ++digit) {
+            packedDigits |= Word(digits[i + digit] - '0') << (bitsPerDigit * digit);
+        }
+        appendDigits(packedDigits, digitsPerWord);
+    }
+    for (; i < digits.size(); ++i) push_back(digits[i] - '0');
+}
+
+bool ChainCode::isText(std::string_view digits) {
+    return digits.find_first_not_of("01234567") == std::string_view::npos;
+}
+
+void ChainCode::append(const ChainCode &other, std::size_t from, std::size_t count) {
+    reserve(length + count);
+    std::size_t i = from;
+    for (; i + digitsPerWord <= from + count; i += digitsPerWord) {
+        appendDigits(other.getDigits(i, digitsPerWord), digitsPerWord);
+    }
+    if (i < from + count) appendDigits(other.getDigits(i, (int) (from + count - i)), (int) (from + count - i));
+}
+
+void ChainCode::append(const unsigned char *digits, std::size_t count) {
+    reserve(length + count);
+    std::size_t i = 0;
+    for (; i + digitsPerWord <= count; i += digitsPerWord) {
+        Word packedDigits = 0;
+        for (int digit = 0; digit < digitsPerWord; ++digit) {
+            packedDigits |= Word(digits[i + digit]) << (bitsPerDigit * digit);
+        }
+        appendDigits(packedDigits, digitsPerWord);
+    }
+    for (; i < count; ++i) push_back(digits[i]);
+}
+
+void ChainCode::grow(std::size_t count) {
+    length += count;
+    words.resize((length * bitsPerDigit + 63) / 64);
+}
+
+void ChainCode::clear() {
+    words.clear();
+    length = 0;
+}
+
+void ChainCode::assign(std::vector<Word> &&packedWords, std::size_t numberOfDigits) {
+    words = std::move(packedWords);
+    length = numberOfDigits;
+    words.resize((length * bitsPerDigit + 63) / 64);
+//    keep the bits after the last digit zero
+    const int usedBits = (int) (length * bitsPerDigit % 64);
+    if (usedBits != 0) words.back() &= (Word(1) << usedBits) - 1;
+}
+
+std::string ChainCode::toString() const {
+    std::string digits(length, '0');
+    for (std::size_t i = 0; i < length; i += digitsPerWord) {
+        const int count = (int) std::min<std::size_t>(digitsPerWord, length - i);
+        Word packedDigits = getDigits(i, count);
+        for (int digit = 0; digit < count; ++digit, packedDigits >>= bitsPerDigit) {
+            digits[i + digit] = (char) ('0' + (packedDigits & 7));
+        }
+    }
+    return digits;
+}
@@ -0,0 +1,105 @@
+#ifndef MID_CRACK_CODE_CHAINCODE_H
+#define MID_CRACK_CODE_CHAINCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Receiver of the digits of a mid-crack chain code while they are produced.
+class ChainCodeSink {
+public:
+    virtual void push_back(int digit) = 0;
+
+protected:
+    ~ChainCodeSink() = default;
+};
+
+/// Digits 0-7 of a mid-crack chain code packed into 3 bits each.
+/// Digit i is stored in bits [3i, 3i + 3) of the words, least significant bit first, so a digit can span two words.
+/// The bits after the last digit are always zero.
+class ChainCode {
+public:
+    using Word = std::uint64_t;
+    static const int bitsPerDigit = 3;
+//    largest number of digits that fit into a word
+    static const int digitsPerWord = 21;
+
+private:
+    std::vector<Word> words;
+    std::size_t length{};
+
+public:
+    ChainCode() = default;
+
+    /// \param digits Characters '0'-'7'.
+    explicit ChainCode(std::string_view digits);
+
+    /// \return True if all the characters are digits from '0' to '7'.
+    static bool isText(std::string_view digits);
+
+    [[nodiscard]] std::size_t size() const { return length; }
+
+    [[nodiscard]] bool empty() const { return length == 0; }
+
+    [[nodiscard]] const std::vector<Word> &getWords() const { return words; }
+
+    int operator[](std::size_t i) const { return (int) getDigits(i, 1); }
+
+    /// Get count (up to digitsPerWord) digits from i on, digit i in the lowest bits.
+    [[nodiscard]] Word getDigits(std::size_t i, int count) const {
+        const std::size_t bit = i * bitsPerDigit;
+        const std::size_t word = bit / 64;
+        const int offset = (int) (bit % 64);
+        Word digits = words[word] >> offset;
+        if (offset + count * bitsPerDigit > 64) digits |= words[word + 1] << (64 - offset);
+        return digits & ((Word(1) << (count * bitsPerDigit)) - 1);
+    }
+
+    /// Append count (up to digitsPerWord) digits, the first one in the lowest bits.
+    void appendDigits(Word digits, int count) {
+        const std::size_t bit = length * bitsPerDigit;
+        const std::size_t word = bit / 64;
+        const int offset = (int) (bit % 64);
+        const std::size_t wordsNeeded = (bit + count * bitsPerDigit + 63) / 64;
+        if (words.size() < wordsNeeded) words.resize(wordsNeeded);
+        words[word] |= digits << offset;
+        if (offset + count * bitsPerDigit > 64) words[word + 1] |= digits >> (64 - offset);
+        length += count;
+    }
+
+    void push_back(int digit) { appendDigits((Word) digit, 1); }
+
+    /// Append the digits [from, from + count) of other.
+    void append(const ChainCode &other, std::size_t from, std::size_t count);
+
+    void append(const ChainCode &other) { append(other, 0, other.length); }
+
+    /// Append digits stored one per byte.
+    void append(const unsigned char *digits, std::size_t count);
+
+    /// Add count zero digits at the end.
+    void grow(std::size_t count);
+
+    /// Set digit i, which has to be zero.
+    void set(std::size_t i, int digit) {
+        const std::size_t bit = i * bitsPerDigit;
+        const int offset = (int) (bit % 64);
+        words[bit / 64] |= Word(digit) << offset;
+        if (offset > 64 - bitsPerDigit) words[bit / 64 + 1] |= Word(digit) >> (64 - offset);
+    }
+
+    void reserve(std::size_t digits) { words.reserve((digits * bitsPerDigit + 63) / 64); }
+
+    void clear();
+
+    /// Set the digits from words packed like getWords.
+    void assign(std::vector<Word> &&packedWords, std::size_t numberOfDigits);
+
+    /// \return The digits as characters '0'-'7'.
+    [[nodiscard]] std::string toString() const;
+};
+
+
+#endif //MID_CRACK_CODE_CHAINCODE_H
@@ -0,0 +1,95 @@
+#include "Codec.h"
+#include "Error.h"
+#include "Stats.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+    class LzwBlockCodec final : public BlockCodec {
+    private:
+        int maxCodeWidth;
+        bool resetWhenFull;
+        std::shared_ptr<const LzwDictionary> dictionary;
+
+    public:
+        LzwBlockCodec(int maxCodeWidth, bool resetWhenFull, std::shared_ptr<const LzwDictionary> dictionary)
+                : maxCodeWidth(maxCodeWidth), resetWhenFull(resetWhenFull), dictionary(std::move(dictionary)) {}
+
+        void encode(const ChainCode &digits, std::size_t first, std::size_t count,
+                    std::vector<unsigned char> &bytes) const override {
+            StageTimer timer(Stage::encode);
+            const std::size_t start = bytes.size();
+            encodeLzwBits(digits, first, count, maxCodeWidth, resetWhenFull, dictionary.get(), bytes);
+            addStageSymbols(Stage::encode, count);
+            addStageBytes(Stage::encode, 0, bytes.size() - start);
+        }
+
+        bool decode(const unsigned char *bytes, std::size_t size, unsigned char *digits,
+                    std::size_t count) const override {
+            StageTimer timer(Stage::decode);
+            addStageSymbols(Stage::decode, count);
+            addStageBytes(Stage::decode, size, 0);
+            std::size_t length;
+            return decodeLzwBits(bytes, size, maxCodeWidth, dictionary.get(), digits, count, length) &&
+                   length == count;
+        }
+
+        [[nodiscard]] std::uint64_t getMaxDigits(std::size_t size) const override {
+//            every code has at least lzwMinCodeWidth bits, and its string is at most one digit longer than the
+//            strings in the dictionary before it
+            const std::uint64_t codes = std::uint64_t(size) * 8 / lzwMinCodeWidth;
+            const std::uint64_t primedStrings = dictionary ? dictionary->getEntries().size() : 0;
+            return codes * std::min(std::uint64_t(1) << maxCodeWidth, primedStrings + codes + 1);
+        }
+    };
+
+    class TurnBlockCodec final : public BlockCodec {
+    private:
+        int contextOrder;
+
+    public:
+        explicit TurnBlockCodec(int contextOrder) : contextOrder(contextOrder) {}
+
+        void encode(const ChainCode &digits, std::size_t first, std::size_t count,
+                    std::vector<unsigned char> &bytes) const override {
+            StageTimer timer(Stage::encode);
+            const std::size_t start = bytes.size();
+            encodeTurns(digits, first, count, contextOrder, bytes);
+            addStageSymbols(Stage::encode, count);
+            addStageBytes(Stage::encode, 0, bytes.size() - start);
+        }
+
+        bool decode(const unsigned char *bytes, std::size_t size, unsigned char *digits,
+                    std::size_t count) const override {
+            StageTimer timer(Stage::decode);
+            addStageSymbols(Stage::decode, count);
+            addStageBytes(Stage::decode, size, 0);
+            return decodeTurns(bytes, size, contextOrder, digits, count);
+        }
+
+        [[nodiscard]] std::uint64_t getMaxDigits(std::size_t size) const override {
+//            a probability is at most 2017/2048, so a digit shrinks the range to at most 0.96 of it and a byte
+//            holds fewer than 128 digits
+            return (std::uint64_t(size) + 1) * 128;
+        }
+    };
+}
+
+std::shared_ptr<const BlockCodec> createBlockCodec(const CompressionSettings &settings) {
+    switch (settings.codec) {
+        case CodecType::lzw:
+            if (!fitsLzwDictionary(settings)) {
+                throw MidCrackCodeError("The LZW dictionary has too many strings for the largest code width.");
+            }
+            return std::make_shared<LzwBlockCodec>(settings.maxCodeWidth, settings.resetWhenFull, settings.dictionary);
+        case CodecType::turns:
+            return std::make_shared<TurnBlockCodec>(settings.contextOrder);
+    }
+    return nullptr;
+}
+
+bool fitsLzwDictionary(const CompressionSettings &settings) {
+//    the single digits, the reserved codes and the strings of the dictionary
+    const std::size_t primedCodes = 10 + (settings.dictionary ? settings.dictionary->getEntries().size() : 0);
+    return primedCodes < std::size_t(1) << settings.maxCodeWidth;
+}
@@ -0,0 +1,60 @@
+#ifndef MID_CRACK_CODE_CODEC_H
+#define MID_CRACK_CODE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ChainCode.h"
+#include "Lzw.h"
+#include "LzwDictionary.h"
+#include "RangeCoder.h"
+
+/// Codec of the blocks of a compressed mid-crack code, stored in its header.
+enum class CodecType : unsigned char {
+    lzw = 0, // LZW codes of variable width (see encodeLzwBits)
+    turns = 1 // relative turns with an adaptive range coder (see encodeTurns)
+};
+
+const std::uint32_t defaultSymbolsPerBlock = 1 << 20;
+
+/// Settings of the compression of a mid-crack code.
+struct CompressionSettings {
+    CodecType codec = CodecType::lzw;
+//    LZW codec
+    int maxCodeWidth = lzwDefaultMaxCodeWidth;
+    bool resetWhenFull = true;
+    std::shared_ptr<const LzwDictionary> dictionary; // strings the dictionary starts with, if not null
+//    range coder codec
+    int contextOrder = turnsDefaultContextOrder;
+    std::uint32_t symbolsPerBlock = defaultSymbolsPerBlock;
+};
+
+/// Compression of a block of digits on its own, without anything from the blocks before it.
+class BlockCodec {
+public:
+    virtual ~BlockCodec() = default;
+
+    /// Compress the digits [first, first + count) of a chain code.
+    /// \param bytes The compressed block is appended to bytes.
+    virtual void encode(const ChainCode &digits, std::size_t first, std::size_t count,
+                        std::vector<unsigned char> &bytes) const = 0;
+
+    /// Decompress a block of count digits, one digit per byte.
+    /// \return False if the block is corrupted.
+    virtual bool decode(const unsigned char *bytes, std::size_t size, unsigned char *digits,
+                        std::size_t count) const = 0;
+
+    /// \return An upper bound of the number of digits a block of size bytes decompresses to.
+    [[nodiscard]] virtual std::uint64_t getMaxDigits(std::size_t size) const = 0;
+};
+
+/// \return The codec of settings.codec with its parameters in settings.
+/// \throw MidCrackCodeError If the LZW dictionary does not leave room for new strings with the largest code width.
+std::shared_ptr<const BlockCodec> createBlockCodec(const CompressionSettings &settings);
+
+/// \return False if the LZW dictionary of the settings has 2^maxCodeWidth codes or more with the reserved codes.
+bool fitsLzwDictionary(const CompressionSettings &settings);
+
+
+#endif //MID_CRACK_CODE_CODEC_H
@@ -0,0 +1,736 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include "ContourTracer.h"
+#include "Stats.h"
+
+namespace {
+    constexpr int yDir[] = {1, 1, 1, 0, -1, -1, -1, 0}; // where to look in the y axis relative to the current edge
+    constexpr int xDir[] = {1, 0, -1, -1, -1, 0, 1, 1}; // where to look in the x axis relative to the current edge
+
+//    move from an edge of a contour (pixel and direction of its edge) to the next black pixel of the contour
+    struct TraceMove {
+        std::uint16_t digits; // digits of the move, the first one in the lowest bits
+        std::uint8_t numberOfDigits;
+        std::int8_t dx, dy; // 0 if the pixel has no black neighbours
+        std::uint16_t next; // first move of the direction of the edge of the next pixel
+    };
+
+    const int neighbourhoodsPerDirection = 512;
+
+//    the move for every direction of the edge and every 3x3 pixels around its pixel (bits as in
+//    Bitmap::getNeighbourhood): the neighbours are looked at in clockwise order, starting with the diagonal neighbour
+//    ahead of the edge, and every corner passed on the way to the first black one adds a digit
+    constexpr std::array<TraceMove, 4 * neighbourhoodsPerDirection> makeTraceMoves() {
+        std::array<TraceMove, 4 * neighbourhoodsPerDirection> moves{};
+        for (int direction = 0; direction < 8; direction += 2) {
+            for (int neighbourhood = 0; neighbourhood < neighbourhoodsPerDirection; ++neighbourhood) {
+                TraceMove move{0, 0, 0, 0, (std::uint16_t) (direction / 2 * neighbourhoodsPerDirection)};
+                const auto addDigit = [&move](int digit) {
+                    move.digits |= digit << (ChainCode::bitsPerDigit * move.numberOfDigits++);
+                };
+                for (int i = 0; i < 7; ++i) {
+                    const int neighbour = (8 - direction + i) % 8;
+                    const int digit = (direction - i + 7) % 8;
+                    if (i != 0 && i % 2 == 0) addDigit(digit);
+                    if ((neighbourhood >> ((yDir[neighbour] + 1) * 3 + xDir[neighbour] + 1)) & 1) {
+                        move.dx = (std::int8_t) xDir[neighbour];
+                        move.dy = (std::int8_t) yDir[neighbour];
+                        const int nextDirection = (direction + 2 - 2 * ((i + 1) / 2) + 8) % 8;
+                        move.next = (std::uint16_t) (nextDirection / 2 * neighbourhoodsPerDirection);
+                        addDigit(digit);
+                        break;
+                    }
+                }
+                moves[direction / 2 * neighbourhoodsPerDirection + neighbourhood] = move;
+            }
+        }
+        return moves;
+    }
+
+    constexpr std::array<TraceMove, 4 * neighbourhoodsPerDirection> traceMoves = makeTraceMoves();
+
+//    digits of a contour packed like a ChainCode while it is traced. The words are grown ahead of the digits, so
+//    adding digits has no branch for the digits that spill into the next word
+    class PackedDigits {
+    private:
+        std::vector<ChainCode::Word> words = std::vector<ChainCode::Word>(16, 0);
+        std::size_t length{};
+
+    public:
+        /// Append count (up to digitsPerWord) digits, the first one in the lowest bits.
+        void append(ChainCode::Word digits, int count) {
+            const std::size_t bit = length * ChainCode::bitsPerDigit;
+            if (bit / 64 + 2 > words.size()) words.resize(words.size() * 2, 0);
+            const int offset = (int) (bit % 64);
+            words[bit / 64] |= digits << offset;
+            words[bit / 64 + 1] |= (digits >> 1) >> (63 - offset); // the shift is split so that it is never by 64
+            length += count;
+        }
+
+        void push_back(int digit) { append((ChainCode::Word) digit, 1); }
+
+        [[nodiscard]] std::size_t size() const { return length; }
+
+        ChainCode release() {
+            ChainCode midCrackCode;
+            midCrackCode.assign(std::move(words), length);
+            return midCrackCode;
+        }
+    };
+
+    void addDigits(PackedDigits &midCrackCode, const TraceMove &move) {
+        midCrackCode.append(move.digits, move.numberOfDigits);
+    }
+
+    void addDigits(ChainCodeSink &sink, const TraceMove &move) {
+        for (int i = 0; i < move.numberOfDigits; ++i) {
+            sink.push_back((move.digits >> (ChainCode::bitsPerDigit * i)) & 7);
+        }
+    }
+
+//    add additional edges around the starting position of an outer contour
+    template<class Code>
+    void closeOuterContour(int direction, Code &midCrackCode) {
+        if (direction == 0) { // if right
+            midCrackCode.push_back(5);
+            midCrackCode.push_back(3);
+            midCrackCode.push_back(1);
+        } else if (direction == 6) { // if bottom
+            midCrackCode.push_back(3);
+            midCrackCode.push_back(1);
+        } else if (direction == 4) midCrackCode.push_back(1); // if left
+    }
+
+//    trace a contour one move to the next black pixel at a time: the 3x3 pixels around the pixel and the direction of
+//    its edge select the move from a table. the white border of the bitmap makes the neighbours of every pixel
+//    readable, so there are no bounds to check, and the position of the neighbours moves along with the pixel
+    template<class Code>
+    void traceContourDigits(const Bitmap &bitmap, int startX, int startY, int startDirection, Code &midCrackCode,
+                            ContourBox &box) {
+        StageTimer timer(Stage::trace);
+        const bool outerContour = startDirection == 2;
+        const std::ptrdiff_t bitsPerRow = bitmap.getBitsPerRow();
+
+        int x = startX, y = startY; // position of pixel of last detected edge
+        std::size_t position = bitmap.getNeighbourhoodPosition(x, y);
+        unsigned direction = startDirection / 2 * neighbourhoodsPerDirection; // first move of the direction
+        const unsigned lastDirection = direction;
+        int left = x, top = y, right = x, bottom = y;
+        do { // trace edges of the image
+            const TraceMove &move = traceMoves[direction + bitmap.getNeighbourhood(position)];
+            addDigits(midCrackCode, move);
+            x += move.dx;
+            y += move.dy;
+            position += move.dx + move.dy * bitsPerRow;
+            direction = move.next;
+            left = std::min(left, x);
+            top = std::min(top, y);
+            right = std::max(right, x);
+            bottom = std::max(bottom, y);
+//            outer contours end when the starting pixel is reached, holes when the starting edge is reached
+        } while (x != startX || y != startY || (!outerContour && direction != lastDirection));
+        box = {left, top, right, bottom};
+        if (outerContour) closeOuterContour((int) (direction / neighbourhoodsPerDirection * 2), midCrackCode);
+    }
+
+    template<class Code>
+    MidCrackCode traceFirstContourDigits(const Bitmap &bitmap, Code &code) {
+        MidCrackCode midCrackCode;
+        MidCrackChain &chain = midCrackCode.chains.emplace_back();
+        bool found;
+        {
+            StageTimer timer(Stage::findStarts);
+            found = bitmap.findFirstSet(chain.startX, chain.startY);
+        }
+        if (!found) { // no black pixels
+            chain.startX = chain.startY = 0;
+            return midCrackCode;
+        }
+        ContourBox box;
+        traceContourDigits(bitmap, chain.startX, chain.startY, chain.startDirection, code, box);
+        box.setImageOf(midCrackCode);
+        return midCrackCode;
+    }
+}
+
+ChainCode traceContour(const Bitmap &bitmap, int startX, int startY, int startDirection) {
+    PackedDigits midCrackCode; // solution
+    ContourBox box;
+    traceContourDigits(bitmap, startX, startY, startDirection, midCrackCode, box);
+    addStageSymbols(Stage::trace, midCrackCode.size());
+    return midCrackCode.release();
+}
+
+void traceContour(const Bitmap &bitmap, int startX, int startY, int startDirection, ChainCodeSink &sink) {
+    ContourBox box;
+    traceContourDigits(bitmap, startX, startY, startDirection, sink, box);
+}
+
+void ContourBox::setImageOf(MidCrackCode &midCrackCode) const {
+    midCrackCode.imageWidth = right - left + 1;
+    midCrackCode.imageHeight = bottom - top + 1;
+    midCrackCode.chains[0].startX -= left;
+    midCrackCode.chains[0].startY -= top;
+}
+
+MidCrackCode traceFirstContour(const Bitmap &bitmap) {
+    PackedDigits code;
+    MidCrackCode midCrackCode = traceFirstContourDigits(bitmap, code);
+    addStageSymbols(Stage::trace, code.size());
+    midCrackCode.chains[0].code = code.release();
+    return midCrackCode;
+}
+
+MidCrackCode traceFirstContour(const Bitmap &bitmap, ChainCodeSink &sink) {
+    return traceFirstContourDigits(bitmap, sink);
+}
+
+void followMidCrackDigit(int &x, int &y, int &direction, int digit) {
+    static const int yDirOfDigit[] = {0, 1, 1, 0, 0, -1, 0, -1, -1, 0, 0, 1}; // where to move in the y axis
+    static const int xDirOfDigit[] = {0, 0, 1, 0, 1, 1, 0, 0, -1, 0, -1, -1}; // where to move in the x axis
+
+    int indexForXAndYArrays = (digit + (3 - direction)) % 8 + ((direction / 2) * 3);
+    y += yDirOfDigit[indexForXAndYArrays];
+    x += xDirOfDigit[indexForXAndYArrays];
+    direction = (12 - direction + (digit * 2)) % 8;
+}
+
+namespace {
+//    run of pixels of the same color in a row, [x0, x1)
+    struct Run {
+        int y;
+        int x0;
+        int x1;
+    };
+
+    int findRoot(std::vector<int> &parent, int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+//    the root of a set is always its first run, which holds the top-left pixel of the component
+    void unite(std::vector<int> &parent, int a, int b) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a < b) parent[b] = a;
+        else if (b < a) parent[a] = b;
+    }
+
+//    label the components of pixels of one color
+//    \param connectivityExtension 1 for 8-connected components, 0 for 4-connected components
+    void labelRuns(const Bitmap &bitmap, bool black, int connectivityExtension, std::vector<Run> &runs,
+                   std::vector<int> &parent) {
+        std::size_t previousRowBegin = 0, previousRowEnd = 0;
+        for (int y = 0; y < bitmap.getHeight(); ++y) {
+            const std::size_t rowBegin = runs.size();
+            for (int x = bitmap.findInRow(y, 0, black); x < bitmap.getWidth();) {
+                const int end = bitmap.findInRow(y, x, !black);
+                runs.push_back({y, x, end});
+                parent.push_back((int) parent.size());
+                x = bitmap.findInRow(y, end, black);
+            }
+
+//            connect the runs with the touching runs in the previous row
+            std::size_t i = rowBegin, j = previousRowBegin;
+            while (i < runs.size() && j < previousRowEnd) {
+                if (runs[i].x0 - connectivityExtension < runs[j].x1 &&
+                    runs[j].x0 < runs[i].x1 + connectivityExtension) {
+                    unite(parent, (int) i, (int) j);
+                }
+                if (runs[i].x1 < runs[j].x1) ++i;
+                else ++j;
+            }
+            previousRowBegin = rowBegin;
+            previousRowEnd = runs.size();
+        }
+    }
+}
+
+std::vector<MidCrackChain> findContourStarts(const Bitmap &bitmap, bool holes) {
+    StageTimer timer(Stage::findStarts);
+    std::vector<MidCrackChain> starts;
+
+//    outer contours start on the top edge of the first pixel of each component of black pixels
+    std::vector<Run> runs;
+    std::vector<int> parent;
+    labelRuns(bitmap, true, 1, runs, parent);
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        if (parent[i] == (int) i) starts.push_back({runs[i].x0, runs[i].y, 2, {}});
+    }
+
+    if (holes) {
+        runs.clear();
+        parent.clear();
+        labelRuns(bitmap, false, 0, runs, parent);
+
+//        components of white pixels that touch the border are the background
+        std::vector<bool> background(runs.size(), false);
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            if (runs[i].x0 == 0 || runs[i].x1 == bitmap.getWidth() || runs[i].y == 0 ||
+                runs[i].y == bitmap.getHeight() - 1) {
+                background[findRoot(parent, (int) i)] = true;
+            }
+        }
+//        holes start on the bottom edge of the pixel above the first pixel of the hole
+        const std::size_t numberOfOuterContours = starts.size();
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            if (parent[i] == (int) i && !background[i]) starts.push_back({runs[i].x0, runs[i].y - 1, 6, {}});
+        }
+        std::inplace_merge(starts.begin(), starts.begin() + (long) numberOfOuterContours, starts.end(),
+                           [](const MidCrackChain &a, const MidCrackChain &b) {
+                               return std::tie(a.startY, a.startX, a.startDirection) <
+                                      std::tie(b.startY, b.startX, b.startDirection);
+                           });
+    }
+    return starts;
+}
+
+MidCrackCode traceAllContours(const Bitmap &bitmap, bool holes, ThreadPool &pool) {
+    MidCrackCode midCrackCode;
+    midCrackCode.imageWidth = bitmap.getWidth();
+    midCrackCode.imageHeight = bitmap.getHeight();
+    midCrackCode.chains = findContourStarts(bitmap, holes);
+    pool.parallelFor(midCrackCode.chains.size(), [&](std::size_t i) {
+        MidCrackChain &chain = midCrackCode.chains[i];
+        chain.code = traceContour(bitmap, chain.startX, chain.startY, chain.startDirection);
+    });
+    return midCrackCode;
+}
+
+namespace {
+//    edge of a pixel as a single number that sorts in row-major order of the pixels
+    using EdgeKey = std::uint64_t;
+
+    EdgeKey getEdgeKey(int width, int x, int y, int direction) {
+        return ((EdgeKey) y * width + x) << 2 | (direction / 2);
+    }
+
+    void getEdge(int width, EdgeKey key, int &x, int &y, int &direction) {
+        direction = (int) (key & 3) * 2;
+        y = (int) ((key >> 2) / width);
+        x = (int) ((key >> 2) % width);
+    }
+
+//    whether the pixel (x + dx, y + dy) is black in the neighbourhood of the pixel (x, y)
+    bool isBlack(unsigned neighbourhood, int dx, int dy) {
+        return (neighbourhood >> ((dy + 1) * 3 + dx + 1)) & 1;
+    }
+
+    unsigned getNeighbourhood(const Bitmap &bitmap, int x, int y) {
+        return bitmap.getNeighbourhood(bitmap.getNeighbourhoodPosition(x, y));
+    }
+
+//    whether a contour can start on the edge: the top edge of a pixel with only white pixels to the left of it and
+//    above it, or the bottom edge of a pixel above a white pixel that has a black pixel to its left.
+//    every contour has such an edge where it starts, but not every such edge is the start of a contour
+    bool canStartContour(const Bitmap &bitmap, int x, int y, int direction) {
+        const unsigned neighbourhood = getNeighbourhood(bitmap, x, y);
+        if (direction == 2) {
+            return !isBlack(neighbourhood, -1, 0) && !isBlack(neighbourhood, -1, -1) &&
+                   !isBlack(neighbourhood, 0, -1) && !isBlack(neighbourhood, 1, -1);
+        }
+        return direction == 6 && !isBlack(neighbourhood, 0, 1) && isBlack(neighbourhood, -1, 1);
+    }
+
+//    pixel on the other side of the edge in each direction (right, top, left, bottom)
+    const int xAcrossEdge[] = {1, 0, -1, 0};
+    const int yAcrossEdge[] = {0, -1, 0, 1};
+
+//    move from an edge of a contour to the next one, which is one digit of its mid-crack code: to the diagonal
+//    neighbour, to the neighbour straight ahead, or around the corner to the next edge of the same pixel.
+//    traceStep is a sequence of these moves that ends when another pixel is reached; unlike traceStep, every edge of
+//    the contour is visited, so each edge has exactly one edge before and after it
+    int crackStep(const Bitmap &bitmap, int &x, int &y, int &direction) {
+        const unsigned neighbourhood = getNeighbourhood(bitmap, x, y);
+        const int diagonal = (8 - direction) % 8; // first element in the xDir and yDir arrays to look at
+        if (isBlack(neighbourhood, xDir[diagonal], yDir[diagonal])) {
+            x += xDir[diagonal];
+            y += yDir[diagonal];
+            const int digit = (direction + 7) % 8;
+            direction = (direction + 2) % 8;
+            return digit;
+        }
+        const int straight = (9 - direction) % 8;
+        if (isBlack(neighbourhood, xDir[straight], yDir[straight])) {
+            x += xDir[straight];
+            y += yDir[straight];
+            return (direction + 6) % 8;
+        }
+        const int digit = (direction + 5) % 8;
+        direction = (direction + 6) % 8;
+        return digit;
+    }
+
+    bool isIsolated(const Bitmap &bitmap, int x, int y) {
+        return (getNeighbourhood(bitmap, x, y) & ~(1u << 4)) == 0; // no black pixels but the pixel itself
+    }
+
+//    part of a contour that lies in one stripe
+    struct Fragment {
+        EdgeKey first; // edge the fragment starts on
+        EdgeKey next; // edge after the last edge of the fragment, where the next fragment starts
+        bool canStart; // a contour can start on the first edge
+        bool isolated; // the pixel of the first edge has no black neighbours
+        ChainCode code;
+    };
+
+//    split the contours that pass through the rows [y0, y1) into fragments, which start where a contour enters the
+//    stripe or could start, and end where it leaves the stripe or reaches the start of another fragment.
+//    the bitmap may be a window of the image whose row 0 is the row firstRow of the image; the fragments get the edges
+//    of the image. the rows y0 - 2 to y1 + 1 are read
+    void traceStripe(const Bitmap &bitmap, int y0, int y1, int firstRow, std::vector<Fragment> &fragments) {
+        const int width = bitmap.getWidth();
+        std::vector<EdgeKey> firstEdges;
+
+//        edges that are entered from the rows next to the stripe
+        for (int y : {y0 - 1, y1}) {
+            if (y < 0 || y >= bitmap.getHeight()) continue;
+            for (int x = bitmap.findInRow(y, 0, true); x < width; x = bitmap.findInRow(y, x + 1, true)) {
+                const unsigned neighbourhood = getNeighbourhood(bitmap, x, y);
+                for (int direction = 0; direction < 8; direction += 2) {
+                    int xNext = x, yNext = y, directionNext = direction;
+                    if (isBlack(neighbourhood, xAcrossEdge[direction / 2], yAcrossEdge[direction / 2])) {
+                        continue; // not an edge of a contour
+                    }
+                    crackStep(bitmap, xNext, yNext, directionNext);
+                    if (yNext >= y0 && yNext < y1) {
+                        firstEdges.push_back(getEdgeKey(width, xNext, yNext + firstRow, directionNext));
+                    }
+                }
+            }
+        }
+
+//        edges where contours can start
+        for (int y = y0; y < y1; ++y) {
+            for (int x = bitmap.findInRow(y, 0, true); x < width;) {
+                if (canStartContour(bitmap, x, y, 2)) firstEdges.push_back(getEdgeKey(width, x, y + firstRow, 2));
+                x = bitmap.findInRow(y, bitmap.findInRow(y, x, false), true);
+            }
+            if (y + 1 == bitmap.getHeight()) continue;
+            for (int x = bitmap.findInRow(y + 1, 0, false); x < width;) {
+                if (canStartContour(bitmap, x, y, 6) && bitmap.get(x, y)) {
+                    firstEdges.push_back(getEdgeKey(width, x, y + firstRow, 6));
+                }
+                x = bitmap.findInRow(y + 1, bitmap.findInRow(y + 1, x, true), false);
+            }
+        }
+        std::sort(firstEdges.begin(), firstEdges.end());
+        firstEdges.erase(std::unique(firstEdges.begin(), firstEdges.end()), firstEdges.end());
+
+        for (EdgeKey first : firstEdges) {
+            int x, y, direction;
+            getEdge(width, first, x, y, direction);
+            y -= firstRow;
+            Fragment fragment{first, 0, canStartContour(bitmap, x, y, direction), isIsolated(bitmap, x, y), {}};
+            do {
+                fragment.code.push_back(crackStep(bitmap, x, y, direction));
+            } while (y >= y0 && y < y1 && !canStartContour(bitmap, x, y, direction));
+            fragment.next = getEdgeKey(width, x, y + firstRow, direction);
+            fragments.push_back(std::move(fragment));
+        }
+    }
+
+//    concatenate the fragments of a contour, which start with the fragment the contour starts on
+    ChainCode joinFragments(int width, const std::vector<const Fragment *> &contour, int stripeHeight) {
+        ChainCode midCrackCode;
+        int startX, startY, startDirection;
+        getEdge(width, contour[0]->first, startX, startY, startDirection);
+//        traceContour stops after three corners around a pixel with no neighbours
+        if (contour[0]->isolated) return ChainCode("753");
+
+        for (const Fragment *fragment : contour) {
+            int x, y, direction;
+            getEdge(width, fragment->first, x, y, direction);
+            int xNext, yNext, directionNext;
+            getEdge(width, fragment->next, xNext, yNext, directionNext);
+//            an outer contour ends as soon as the starting pixel is reached again, which can only happen in the
+//            fragments in or entering the stripe of the starting pixel; follow the digits of those fragments to find
+//            where it ends
+            if (startDirection == 2 && (y / stripeHeight == startY / stripeHeight ||
+                                        yNext / stripeHeight == startY / stripeHeight)) {
+                for (std::size_t digit = 0; digit < fragment->code.size(); ++digit) {
+                    const int xPrevious = x, yPrevious = y;
+                    followMidCrackDigit(x, y, direction, fragment->code[digit]);
+                    midCrackCode.push_back(fragment->code[digit]);
+                    if (x == startX && y == startY && (x != xPrevious || y != yPrevious)) {
+                        closeOuterContour(direction, midCrackCode);
+                        return midCrackCode;
+                    }
+                }
+            } else {
+                midCrackCode.append(fragment->code);
+            }
+        }
+        return midCrackCode;
+    }
+
+//    make the image of a code with only the first object the bounding box of its chain, like traceFirstContour
+    void setImageOfFirstContour(MidCrackCode &midCrackCode) {
+        if (midCrackCode.chains.empty()) return;
+        const MidCrackChain &chain = midCrackCode.chains[0];
+        int x = chain.startX, y = chain.startY, direction = chain.startDirection;
+        ContourBox box{x, y, x, y};
+        for (std::size_t i = 0; i < chain.code.size(); ++i) {
+            followMidCrackDigit(x, y, direction, chain.code[i]);
+            box.left = std::min(box.left, x);
+            box.top = std::min(box.top, y);
+            box.right = std::max(box.right, x);
+            box.bottom = std::max(box.bottom, y);
+        }
+        box.setImageOf(midCrackCode);
+    }
+}
+
+MidCrackCode traceContoursTiled(const Bitmap &bitmap, bool allContours, bool holes, ThreadPool &pool,
+                                int stripeHeight) {
+    StageTimer timer(Stage::trace);
+    MidCrackCode midCrackCode;
+    if (stripeHeight <= 0) { // a few stripes per thread so that the work balances out
+        stripeHeight = std::max(16, (int) ((bitmap.getHeight() + 4 * pool.getNumberOfThreads() - 1) /
+                                           (4 * pool.getNumberOfThreads())));
+    }
+    const int numberOfStripes = (bitmap.getHeight() + stripeHeight - 1) / stripeHeight;
+
+//    trace the fragments of each stripe in parallel
+    std::vector<std::vector<Fragment>> fragmentsOfStripes(numberOfStripes);
+    pool.parallelFor(numberOfStripes, [&](std::size_t stripe) {
+        traceStripe(bitmap, (int) stripe * stripeHeight,
+                    std::min(bitmap.getHeight(), (int) (stripe + 1) * stripeHeight), 0, fragmentsOfStripes[stripe]);
+    });
+//    stripes are in row-major order, so the fragments are sorted by their first edge
+    std::vector<Fragment> fragments;
+    for (auto &fragmentsOfStripe : fragmentsOfStripes) {
+        std::move(fragmentsOfStripe.begin(), fragmentsOfStripe.end(), std::back_inserter(fragments));
+        fragmentsOfStripe = std::vector<Fragment>();
+    }
+
+//    stitch the fragments: find the fragment that follows each fragment
+    std::vector<std::size_t> nextFragment(fragments.size());
+    for (std::size_t i = 0; i < fragments.size(); ++i) {
+        nextFragment[i] = std::lower_bound(fragments.begin(), fragments.end(), fragments[i].next,
+                                           [](const Fragment &fragment, EdgeKey key) {
+                                               return fragment.first < key;
+                                           }) - fragments.begin();
+    }
+
+//    go around each contour once; it starts on the first of its edges where a contour can start
+//    (the top edge of its top-left pixel, or for a hole, the bottom edge of the pixel above the top-left pixel)
+    std::vector<std::size_t> contourStarts;
+    std::vector<bool> visited(fragments.size(), false);
+    for (std::size_t i = 0; i < fragments.size(); ++i) {
+        if (visited[i]) continue;
+        std::size_t start = fragments.size();
+        std::size_t j = i;
+        do {
+            visited[j] = true;
+            if ((start == fragments.size() || fragments[j].first < fragments[start].first) && fragments[j].canStart) {
+                start = j;
+            }
+            j = nextFragment[j];
+        } while (j != i);
+
+        const bool hole = (fragments[start].first & 3) == 3;
+        if (!hole || holes) contourStarts.push_back(start);
+    }
+    std::sort(contourStarts.begin(), contourStarts.end());
+    if (!allContours) contourStarts.resize(std::min<std::size_t>(1, contourStarts.size())); // the first object
+
+//    join the fragments of each contour in parallel
+    midCrackCode.chains.resize(contourStarts.size());
+    pool.parallelFor(contourStarts.size(), [&](std::size_t i) {
+        std::vector<const Fragment *> contour;
+        std::size_t j = contourStarts[i];
+        do {
+            contour.push_back(&fragments[j]);
+            j = nextFragment[j];
+        } while (j != contourStarts[i]);
+        MidCrackChain &chain = midCrackCode.chains[i];
+        getEdge(bitmap.getWidth(), contour[0]->first, chain.startX, chain.startY, chain.startDirection);
+        chain.code = joinFragments(bitmap.getWidth(), contour, stripeHeight);
+        addStageSymbols(Stage::trace, chain.code.size());
+    });
+    if (allContours) {
+        midCrackCode.imageWidth = bitmap.getWidth();
+        midCrackCode.imageHeight = bitmap.getHeight();
+    } else {
+        setImageOfFirstContour(midCrackCode);
+    }
+    return midCrackCode;
+}
+
+RowReader getRowReader(const Bitmap &bitmap) {
+    return [&bitmap, next = 0](Bitmap &rows, int y, int count) mutable {
+        for (int row = 0; row < count; ++row) {
+            std::copy_n(bitmap.getRow(next + row), bitmap.getWordsPerRow(), rows.getRow(y + row));
+        }
+        next += count;
+    };
+}
+
+namespace {
+//    joins the fragments of the stripes of a streamed image into contours as they arrive. the fragments of a contour
+//    that are known so far form open contours, which are joined when a fragment connects them; a contour is closed
+//    when the fragment after its last one is its first one
+    class FragmentJoiner {
+    private:
+        struct OpenContour {
+            std::list<Fragment> fragments; // in the order of the contour
+            EdgeKey lowest; // first edge of the fragments that comes first in row-major order
+        };
+        using OpenContourIterator = std::list<OpenContour>::iterator;
+
+        int width;
+        bool holes;
+        int stripeHeight;
+        std::list<OpenContour> openContours;
+//        open contours by the first edge of their first fragment and by the edge after their last fragment
+        std::unordered_map<EdgeKey, OpenContourIterator> heads, tails;
+        std::set<EdgeKey> lowestEdges; // of the open contours
+//        closed contours by the edge they start on, which wait for the contours that start before them
+        std::map<EdgeKey, MidCrackChain> closedContours;
+
+//        append the fragments of the contour after to those of the contour before
+        void join(OpenContourIterator before, OpenContourIterator after) {
+            lowestEdges.erase(std::max(before->lowest, after->lowest));
+            before->lowest = std::min(before->lowest, after->lowest);
+            before->fragments.splice(before->fragments.end(), after->fragments);
+            openContours.erase(after);
+        }
+
+        void close(OpenContourIterator contour) {
+            lowestEdges.erase(contour->lowest);
+            const Fragment *start = nullptr;
+            for (const Fragment &fragment : contour->fragments) {
+                if (fragment.canStart && (start == nullptr || fragment.first < start->first)) start = &fragment;
+            }
+            const bool hole = (start->first & 3) == 3;
+            if (!hole || holes) {
+//                go around the contour from the fragment it starts on
+                std::vector<const Fragment *> fragments;
+                auto i = contour->fragments.cbegin();
+                while (&*i != start) ++i;
+                for (auto j = i; j != contour->fragments.cend(); ++j) fragments.push_back(&*j);
+                for (auto j = contour->fragments.cbegin(); j != i; ++j) fragments.push_back(&*j);
+                MidCrackChain chain;
+                getEdge(width, start->first, chain.startX, chain.startY, chain.startDirection);
+                chain.code = joinFragments(width, fragments, stripeHeight);
+                addStageSymbols(Stage::trace, chain.code.size());
+                closedContours.emplace(start->first, std::move(chain));
+            }
+            openContours.erase(contour);
+        }
+
+    public:
+        FragmentJoiner(int width, bool holes, int stripeHeight) : width(width), holes(holes),
+                                                                  stripeHeight(stripeHeight) {}
+
+        void add(Fragment &&fragment) {
+            const EdgeKey first = fragment.first, next = fragment.next;
+//            the fragment starts an open contour of its own, which is joined with the ones before and after it
+            auto contour = openContours.emplace(openContours.end());
+            contour->fragments.push_back(std::move(fragment));
+            contour->lowest = first;
+            lowestEdges.insert(first);
+            if (auto before = tails.find(first); before != tails.end()) {
+                const OpenContourIterator previous = before->second;
+                tails.erase(before);
+                join(previous, contour);
+                contour = previous;
+            } else {
+                heads[first] = contour;
+            }
+            if (auto after = heads.find(next); after != heads.end()) {
+                const OpenContourIterator following = after->second;
+                heads.erase(after);
+                if (following == contour) {
+                    close(contour);
+                    return;
+                }
+                tails[following->fragments.back().next] = contour;
+                join(contour, following);
+            } else {
+                tails[next] = contour;
+            }
+        }
+
+//        pass on the closed contours that start before the edge and before every open contour, in the order of
+//        their starts, until useChain returns false; returns false if it did
+        bool passClosedContours(EdgeKey before, const std::function<bool(MidCrackChain &&chain)> &useChain) {
+            if (!lowestEdges.empty()) before = std::min(before, *lowestEdges.begin());
+            while (!closedContours.empty() && closedContours.begin()->first < before) {
+                const bool more = useChain(std::move(closedContours.begin()->second));
+                closedContours.erase(closedContours.begin());
+                if (!more) return false;
+            }
+            return true;
+        }
+    };
+}
+
+void traceContoursStreaming(int width, int height, const RowReader &readRows, bool allContours, bool holes,
+                            const std::function<void(MidCrackChain &&chain)> &useChain, int stripeHeight) {
+    if (stripeHeight <= 0) stripeHeight = defaultStreamingStripeHeight;
+//    the window has the rows of a stripe and the rows above and below it that are read for the fragments of the
+//    stripe; its row r is the row y0 - margin + r of the image
+    const int margin = 2;
+    Bitmap window(width, stripeHeight + 2 * margin);
+    const auto read = [&](int firstRow, int windowRow, int count) {
+        count = std::min(count, height - firstRow);
+        if (count > 0) readRows(window, windowRow, count);
+    };
+    read(0, margin, stripeHeight + margin);
+
+    FragmentJoiner joiner(width, holes, stripeHeight);
+//    with only the first object, the first outer contour that is passed on is the last one
+    const auto useContour = [&](MidCrackChain &&chain) {
+        useChain(std::move(chain));
+        return allContours;
+    };
+    std::vector<Fragment> fragments;
+    for (int y0 = 0; y0 < height; y0 += stripeHeight) {
+        {
+            StageTimer timer(Stage::trace);
+            fragments.clear();
+            traceStripe(window, margin, margin + std::min(stripeHeight, height - y0), y0 - margin, fragments);
+            for (Fragment &fragment : fragments) joiner.add(std::move(fragment));
+        }
+//        the contours that are not found yet start in the next stripe or later
+        const EdgeKey nextStripe = getEdgeKey(width, 0, std::min(height, y0 + stripeHeight), 0);
+        if (!joiner.passClosedContours(nextStripe, useContour)) return;
+
+//        move the rows below the stripe to the top of the window and read the rows of the next stripe after them
+        const std::size_t wordsPerRow = window.getWordsPerRow();
+        for (int row = 0; row < 2 * margin; ++row) {
+            std::copy_n(window.getRow(stripeHeight + row), wordsPerRow, window.getRow(row));
+        }
+        std::fill_n(window.getRow(2 * margin), wordsPerRow * stripeHeight, 0);
+        read(y0 + stripeHeight + margin, 2 * margin, stripeHeight);
+    }
+}
+
+MidCrackCode traceContoursStreaming(int width, int height, const RowReader &readRows, bool allContours, bool holes,
+                                    int stripeHeight) {
+    MidCrackCode midCrackCode;
+    traceContoursStreaming(width, height, readRows, allContours, holes, [&](MidCrackChain &&chain) {
+        midCrackCode.chains.push_back(std::move(chain));
+    }, stripeHeight);
+    if (allContours) {
+        midCrackCode.imageWidth = width;
+        midCrackCode.imageHeight = height;
+    } else if (midCrackCode.chains.empty()) {
+        midCrackCode.chains.emplace_back(); // no black pixels, like traceFirstContour
+    } else {
+        setImageOfFirstContour(midCrackCode);
+    }
+    return midCrackCode;
+}
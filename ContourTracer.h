@@ -0,0 +1,95 @@
+#ifndef MID_CRACK_CODE_CONTOURTRACER_H
+#define MID_CRACK_CODE_CONTOURTRACER_H
+
+#include <functional>
+#include <vector>
+#include "Bitmap.h"
+#include "ChainCode.h"
+#include "MidCrackChain.h"
+#include "ThreadPool.h"
+
+/// Trace a contour of black pixels (8-connected) and get its mid-crack code.
+/// Outer contours start on the top edge (direction 2) of the top-left pixel of a component and are traced until the
+/// starting pixel is reached again. Holes start on the bottom edge (direction 6) of the black pixel above the top-left
+/// pixel of the hole and are traced until the starting edge is reached again.
+ChainCode traceContour(const Bitmap &bitmap, int startX, int startY, int startDirection);
+
+/// Trace a contour like traceContour and pass its digits to sink as they are found.
+void traceContour(const Bitmap &bitmap, int startX, int startY, int startDirection, ChainCodeSink &sink);
+
+/// Smallest rectangle of pixels that holds a contour; the right and bottom pixels are inside.
+struct ContourBox {
+    int left{}, top{}, right{}, bottom{};
+
+    /// Make the box the image of the single chain of a mid-crack code: set the image size to the size of the box and
+    /// move the start of the chain into it.
+    void setImageOf(MidCrackCode &midCrackCode) const;
+};
+
+/// Trace the outer contour of the first object (the component of the first black pixel in row-major order) as the
+/// only chain of a mid-crack code whose image is the bounding box of the contour. The box is found while tracing, so
+/// the image can be drawn in one pass over the digits.
+/// \return A single empty chain without an image size if the bitmap has no black pixels.
+MidCrackCode traceFirstContour(const Bitmap &bitmap);
+
+/// Trace the first contour like traceFirstContour and pass its digits to sink as they are found.
+/// \return The image size and the start of the chain, without its digits.
+MidCrackCode traceFirstContour(const Bitmap &bitmap, ChainCodeSink &sink);
+
+/// Move from an edge of a contour to the next one along a digit of its mid-crack code.
+/// \param x, y Pixel the edge belongs to.
+/// \param direction Direction of the edge (2 = top; 0 = right; 6 = bottom; 4 = left).
+void followMidCrackDigit(int &x, int &y, int &direction, int digit);
+
+/// Find where the contours of all the components of black pixels (8-connected) start, using a union-find labeling of
+/// the runs of pixels in each row.
+/// \param holes Also find the contours of holes (components of white pixels (4-connected) that do not touch the
+/// border of the bitmap).
+/// \return Chains with empty codes, ordered by their starting pixel (row-major) and direction.
+std::vector<MidCrackChain> findContourStarts(const Bitmap &bitmap, bool holes);
+
+/// Trace the contours of all the components of black pixels, each contour as a separate task on the thread pool.
+MidCrackCode traceAllContours(const Bitmap &bitmap, bool holes, ThreadPool &pool);
+
+
+/// Trace contours like traceAllContours (or only the first one), splitting the bitmap into horizontal stripes.
+/// The contours are split into fragments in each stripe in parallel and the fragments are then stitched back together,
+/// so the codes are the same as those of traceContour.
+/// \param allContours Trace the contours of all the components, not only the first one.
+/// \param stripeHeight Number of rows in each stripe; 0 picks a few stripes per thread.
+MidCrackCode traceContoursTiled(const Bitmap &bitmap, bool allContours, bool holes, ThreadPool &pool,
+                                int stripeHeight = 0);
+
+/// Reads the next rows of an image from the top into the rows [y, y + count) of a bitmap as wide as the image, whose
+/// pixels are white.
+using RowReader = std::function<void(Bitmap &bitmap, int y, int count)>;
+
+/// Row reader that copies the rows of a bitmap, which has to outlive it, to trace a bitmap in memory like an image that
+/// is read.
+RowReader getRowReader(const Bitmap &bitmap);
+
+/// Number of rows in each stripe of traceContoursStreaming if none is given.
+const int defaultStreamingStripeHeight = 64;
+
+/// Trace contours like traceContoursTiled while the rows of the image are read once from the top, so the image is
+/// never in memory as a whole. Only a window of a stripe of rows and the two rows above and below it is kept: the
+/// contours are split into fragments in each stripe as it is read, and the fragments are joined with the open
+/// contours they touch. A contour is passed on as soon as it is closed and all the contours that start before it are
+/// passed on, so the chains come in the order of traceAllContours and the codes are the same as those of
+/// traceContour. The memory is that of the window, of the open contours and of the closed contours that wait for an
+/// open one that starts before them.
+/// \param width, height Size of the image.
+/// \param allContours Trace the contours of all the components; otherwise the rows after the first object are not
+/// read.
+/// \param useChain Gets every chain when it is passed on.
+/// \param stripeHeight Number of rows in each stripe; 0 is defaultStreamingStripeHeight.
+void traceContoursStreaming(int width, int height, const RowReader &readRows, bool allContours, bool holes,
+                            const std::function<void(MidCrackChain &&chain)> &useChain, int stripeHeight = 0);
+
+/// Trace contours like traceContoursStreaming and get a mid-crack code like traceContoursTiled, or like
+/// traceFirstContour if the image has no black pixels.
+MidCrackCode traceContoursStreaming(int width, int height, const RowReader &readRows, bool allContours, bool holes,
+                                    int stripeHeight = 0);
+
+
+#endif //MID_CRACK_CODE_CONTOURTRACER_H
@@ -0,0 +1,21 @@
+#ifndef MID_CRACK_CODE_ERROR_H
+#define MID_CRACK_CODE_ERROR_H
+
+#include <stdexcept>
+#include <string>
+
+/// Error that stops the processing of a file. A single file run prints the message and exits with the exit code, a
+/// batch lists it in its summary and goes on with the next file.
+class MidCrackCodeError : public std::runtime_error {
+private:
+    int exitCode;
+
+public:
+    explicit MidCrackCodeError(const std::string &message, int exitCode = 1)
+            : std::runtime_error(message), exitCode(exitCode) {}
+
+    [[nodiscard]] int getExitCode() const { return exitCode; }
+};
+
+
+#endif //MID_CRACK_CODE_ERROR_H
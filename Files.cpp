@@ -0,0 +1,57 @@
+#include <iterator>
+#include <utility>
+#include "Error.h"
+#include "Files.h"
+#include "Stats.h"
+
+std::ifstream openInputFile(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+        throw MidCrackCodeError("The file could not be opened.");
+    }
+    return file;
+}
+
+void readWholeFile(const std::string &fileName, std::vector<unsigned char> &bytes) {
+    StageTimer timer(Stage::readFile);
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+        throw MidCrackCodeError("The file could not be opened.");
+    }
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    addStageBytes(Stage::readFile, bytes.size(), 0);
+}
+
+void writeWholeFile(const std::string &fileName, const std::vector<unsigned char> &bytes) {
+    StageTimer timer(Stage::writeFile);
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+        throw MidCrackCodeError("The file could not be opened.");
+    }
+    file.write((const char *) bytes.data(), (std::streamsize) bytes.size());
+    addStageBytes(Stage::writeFile, 0, bytes.size());
+}
+
+void writeMidCrackCode(const std::string &fileName, const MidCrackCode &midCrackCode) {
+    StageTimer timer(Stage::writeFile);
+    std::ofstream outputFile;
+    outputFile.open(fileName, std::ios::binary);
+    if (!outputFile.is_open()) {
+        throw MidCrackCodeError("The file could not be opened.");
+    }
+    writeMidCrackCode(outputFile, midCrackCode, fileName.ends_with(".mcc"));
+    addStageBytes(Stage::writeFile, 0, (std::uint64_t) outputFile.tellp());
+    outputFile.close();
+}
+
+void saveBitmap(const std::string &fileName, Bitmap &&bitmap, ImageFormat format) {
+    Image image;
+    image.setBitmap(std::move(bitmap));
+    std::ofstream f;
+    f.open(fileName, std::ios::out | std::ios::binary);
+    if (!f.is_open()) {
+        throw MidCrackCodeError("The file could not be opened.");
+    }
+    image.writeImage(f, format);
+    f.close();
+}
@@ -0,0 +1,33 @@
+#ifndef MID_CRACK_CODE_FILES_H
+#define MID_CRACK_CODE_FILES_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Bitmap.h"
+#include "Image.h"
+#include "MidCrackChain.h"
+
+// Files of the programs around the midcrack library, which works only in memory and on streams.
+
+/// Open a file for reading in binary mode.
+/// \throw MidCrackCodeError If the file cannot be opened.
+std::ifstream openInputFile(const std::string &fileName);
+
+/// \param bytes Gets the whole file; its memory is reused when it is read into again.
+/// \throw MidCrackCodeError If the file cannot be opened.
+void readWholeFile(const std::string &fileName, std::vector<unsigned char> &bytes);
+
+/// \throw MidCrackCodeError If the file cannot be opened.
+void writeWholeFile(const std::string &fileName, const std::vector<unsigned char> &bytes);
+
+/// Write a mid-crack code file, in the .mcc format if the file name ends with .mcc and in the text format otherwise.
+/// \throw MidCrackCodeError If the file cannot be opened.
+void writeMidCrackCode(const std::string &fileName, const MidCrackCode &midCrackCode);
+
+/// Export an image to a .bmp or .pbm file.
+/// \throw MidCrackCodeError If the file cannot be opened or the image is too large for a .bmp file.
+void saveBitmap(const std::string &fileName, Bitmap &&bitmap, ImageFormat format = ImageFormat::bmp24);
+
+
+#endif //MID_CRACK_CODE_FILES_H
@@ -2,220 +2,329 @@
 // Created by Goran Pjević on 01/03/2021.
 //
 
-#include <fstream>
-#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "Binarize.h"
+#include "Error.h"
 #include "Image.h"
+#include "MemoryStream.h"
+#include "Stats.h"
 
 Image::Image() = default;
 
-/// Preprocess image (convert image file into a data structure for further use).
-/// \param imageFilePath File must be a .bmp image in rgb color space and no alpha channel.
-Image::Image(const char *imageFilePath) {
-//    open file
-    std::ifstream f;
-    f.open(imageFilePath, std::ios::in | std::ios::binary);
-    if (!f.is_open()) {
-        std::cout << "The file could not be opened." << std::endl;
-        exit(1);
+Image::Image(std::span<const unsigned char> bytes, int threshold) {
+    MemoryInputBuffer buffer(bytes);
+    std::istream f(&buffer);
+    read(f, threshold);
+}
+
+Image::Image(std::istream &f, int threshold) {
+    read(f, threshold);
+}
+
+namespace {
+    std::uint32_t readNumber(const unsigned char *bytes) {
+        return bytes[0] | std::uint32_t(bytes[1]) << 8 | std::uint32_t(bytes[2]) << 16 | std::uint32_t(bytes[3]) << 24;
     }
 
-//    read headers
-    f.read(reinterpret_cast<char *>(fileHeader), fileHeaderSize);
-    f.read(reinterpret_cast<char *>(informationHeader), informationHeaderSize);
+    void writeNumber(unsigned char *bytes, std::uint32_t value) {
+        for (int byte = 0; byte < 4; ++byte) bytes[byte] = (unsigned char) (value >> (8 * byte));
+    }
 
-    if ((int) informationHeader[14] != 24) { // if bits per pixel is not 24 (3 channels, 8 bits each)
-        std::cout << "The file could not be properly converted. Use file with 24 bits per pixel" << std::endl;
-        f.close();
-        exit(2);
+//    read a number of the header of a .pbm file after whitespace and comments, and the whitespace character after it
+    int readPbmNumber(std::istream &f) {
+        int c = f.get();
+        while (c == '#' || std::isspace(c)) {
+            if (c == '#') {
+                while (c != '\n' && c != std::char_traits<char>::eof()) c = f.get();
+            }
+            c = f.get();
+        }
+        std::int64_t value = 0;
+        if (!std::isdigit(c)) value = -1;
+        for (; std::isdigit(c) && value <= INT32_MAX; c = f.get()) value = value * 10 + (c - '0');
+        if (value <= 0 || value > INT32_MAX || !std::isspace(c)) {
+            throw MidCrackCodeError("The file is not a valid .pbm image.", 3);
+        }
+        return (int) value;
+    }
+}
+
+ImageReader::ImageReader(std::istream &f, int threshold) : f(f), threshold(threshold) {
+    {
+        StageTimer timer(Stage::parseHeader);
+        readHeader();
+    }
+
+//    as many whole rows as fit into the buffer are read at once
+    rowsPerRead = (int) std::max<std::size_t>(1, readBufferSize / std::max<std::size_t>(rowSize, 1));
+    buffer.resize(rowSize * std::min(rowsPerRead, imageHeight));
+
+//    with Otsu's method the threshold is computed from the luminance histogram of the whole image first; the
+//    histogram of an image with a palette is that of the counts of its colors
+    if (threshold == otsuThreshold) {
+        std::uint64_t histogram[256] = {};
+        std::uint64_t counts[256] = {};
+        std::vector<unsigned char> rowLuminance(bitsPerPixel == 24 ? imageWidth : 0);
+        for (int y = 0; y < imageHeight; y += bufferRows) {
+            fillBuffer(y);
+            StageTimer timer(Stage::binarize);
+            for (int row = y; row < y + bufferRows; ++row) {
+                const unsigned char *pixels = getBufferedRow(row);
+                if (bitsPerPixel == 24) {
+                    addRowToHistogram(pixels, imageWidth, histogram, rowLuminance.data());
+                } else if (bitsPerPixel == 8) {
+                    addIndexedRowToHistogram(pixels, imageWidth, counts);
+                } else {
+                    const int ones = countMonochromeRow(pixels, imageWidth);
+                    counts[1] += ones;
+                    counts[0] += imageWidth - ones;
+                }
+            }
+        }
+        if (bitsPerPixel != 24) {
+            for (int i = 0; i < 256; ++i) histogram[luminance[i]] += counts[i];
+        }
+        this->threshold = computeOtsuThreshold(histogram);
+    }
+    for (int i = 0; i < 256; ++i) black[i] = (int) luminance[i] < this->threshold;
+}
+
+void ImageReader::readHeader() {
+    char magic[2]{};
+    f.read(magic, 2);
+    f.seekg(0);
+    if (magic[0] == 'P' && magic[1] == '4') {
+//        binary portable bitmap: "P4", width and height as text, then rows of 1-bit pixels from the top, 1 is black
+        f.seekg(2);
+        imageWidth = readPbmNumber(f);
+        imageHeight = readPbmNumber(f);
+        bitsPerPixel = 1;
+        bottomUp = false;
+        rowSize = ((std::size_t) imageWidth + 7) / 8;
+        pixelDataOffset = f.tellg();
+        luminance[0] = 255;
+        addStageBytes(Stage::parseHeader, (std::uint64_t) pixelDataOffset, 0);
+        return;
+    }
+
+    unsigned char fileHeader[bmpFileHeaderSize]{};
+    unsigned char informationHeader[bmpInformationHeaderSize]{};
+    f.read(reinterpret_cast<char *>(fileHeader), bmpFileHeaderSize);
+    f.read(reinterpret_cast<char *>(informationHeader), bmpInformationHeaderSize);
+    addStageBytes(Stage::parseHeader, bmpFileHeaderSize + bmpInformationHeaderSize, 0);
+
+    bitsPerPixel = informationHeader[14] + (informationHeader[15] << 8);
+    if (bitsPerPixel != 24 && bitsPerPixel != 8 && bitsPerPixel != 1) {
+        throw MidCrackCodeError("The file could not be properly converted. Use file with 1, 8 or 24 bits per pixel", 2);
     }
 
 //    first two bytes of the file must be 'B' and 'M'
     if (fileHeader[0] != 'B' || fileHeader[1] != 'M') {
-        std::cout << "The file is not a bitmap image." << std::endl;
-        f.close();
-        exit(3);
-    }
-
-//    get fileSize, imageWidth and imageHeight from the headers
-    fileSize = fileHeader[2] + (fileHeader[3] << 8) + (fileHeader[4] << 16) + (fileHeader[5] << 24);
-    imageWidth = informationHeader[4] + (informationHeader[5] << 8) + (informationHeader[6] << 16) +
-                 (informationHeader[7] << 24);
-    imageHeight = informationHeader[8] + (informationHeader[9] << 8) + (informationHeader[10] << 16) +
-                  (informationHeader[11] << 24);
-
-//    create 2D array to represent the pixels of the image (0 is white, 1 is black)
-    bitImage = new int *[imageHeight];
-    for (int i = 0; i < imageHeight; ++i) {
-        bitImage[i] = new int[imageWidth];
-    }
-
-//    padding added at the end of each row of pixels
-    const int paddingAmount = (4 - (imageWidth * 3) % 4) % 4;
-
-//    go through each pixel in the image
-    for (int y = 0; y < imageHeight; ++y) {
-        for (int x = 0; x < imageWidth; ++x) {
-            unsigned char color[3];
-            f.read(reinterpret_cast<char *>(color), 3);
-            int r = color[2];
-            int g = color[1];
-            int b = color[0];
-
-            if (r == 255 && g == 255 && b == 255) { // if pixel is white
-                bitImage[y][x] = 0;
-            } else if (r == 0 && g == 0 && b == 0) { // if pixel is black
-                bitImage[y][x] = 1;
-            } else {
-                std::cout << "Color is not black or white." << std::endl;
-                std::cout << "r=" << r << "\ng=" << g << "\nb=" << b << std::endl;
-                bitImage[y][x] = 2;
+        throw MidCrackCodeError("The file is not a bitmap image.", 3);
+    }
+    if (readNumber(informationHeader + 16) != 0) {
+        throw MidCrackCodeError("The file could not be properly converted. Use file without compression", 2);
+    }
+
+//    get fileSize, imageWidth and imageHeight from the headers; a negative height means the rows are stored from the
+//    top
+    fileSize = readNumber(fileHeader + 2);
+    imageWidth = (int) readNumber(informationHeader + 4);
+    const auto storedHeight = (std::int32_t) readNumber(informationHeader + 8);
+    bottomUp = storedHeight > 0;
+    imageHeight = storedHeight == INT32_MIN ? 0 : std::abs(storedHeight);
+    if (imageWidth <= 0 || imageHeight == 0) {
+        throw MidCrackCodeError("The file is not a bitmap image.", 3);
+    }
+
+//    each row of pixels is padded to a multiple of 4 bytes
+    rowSize = ((std::size_t) imageWidth * bitsPerPixel + 31) / 32 * 4;
+
+//    pixel data starts at the offset stored in the file header
+    pixelDataOffset = readNumber(fileHeader + 10);
+
+//    the palette follows the information header, 4 bytes (blue, green, red, unused) per color
+    if (bitsPerPixel != 24) {
+        const std::uint32_t maxColors = 1u << bitsPerPixel;
+        const std::uint32_t numberOfColors = readNumber(informationHeader + 32);
+        const std::size_t colors = numberOfColors == 0 || numberOfColors > maxColors ? maxColors : numberOfColors;
+        std::vector<unsigned char> palette(4 * colors), bgr(3 * colors), paletteLuminance(colors);
+        f.seekg(bmpFileHeaderSize + readNumber(informationHeader));
+        if (!f.read(reinterpret_cast<char *>(palette.data()), (std::streamsize) palette.size())) {
+            throw MidCrackCodeError("The file is truncated.", 4);
+        }
+        addStageBytes(Stage::parseHeader, palette.size(), 0);
+        for (std::size_t i = 0; i < colors; ++i) std::copy_n(&palette[4 * i], 3, &bgr[3 * i]);
+        computeLuminanceRow(bgr.data(), paletteLuminance.data(), (int) colors);
+        std::copy(paletteLuminance.begin(), paletteLuminance.end(), luminance);
+    }
+}
+
+//    read the rows of the image from firstRow into the buffer; the rows of a file stored from the bottom are read from
+//    the end of the file, so they are in the buffer from the bottom
+void ImageReader::fillBuffer(int firstRow) {
+    StageTimer timer(Stage::readFile);
+    bufferFirstRow = firstRow;
+    bufferRows = std::min(rowsPerRead, imageHeight - firstRow);
+    const int firstStoredRow = bottomUp ? imageHeight - firstRow - bufferRows : firstRow;
+    f.clear();
+    f.seekg(pixelDataOffset + (std::streamoff) (rowSize * firstStoredRow));
+    if (!f.read(reinterpret_cast<char *>(buffer.data()), (std::streamsize) (rowSize * bufferRows))) {
+        throw MidCrackCodeError("The file is truncated.", 4);
+    }
+    addStageBytes(Stage::readFile, (std::uint64_t) rowSize * bufferRows, 0);
+}
+
+const unsigned char *ImageReader::getBufferedRow(int y) const {
+    const int row = bottomUp ? bufferFirstRow + bufferRows - 1 - y : y - bufferFirstRow;
+    return buffer.data() + (std::size_t) row * rowSize;
+}
+
+void ImageReader::readRows(Bitmap &bitmap, int y, int count) {
+    while (count > 0) {
+//        an image that fits into the buffer is only read once with Otsu's method
+        if (nextRow < bufferFirstRow || nextRow >= bufferFirstRow + bufferRows) fillBuffer(nextRow);
+        const int rows = std::min(count, bufferFirstRow + bufferRows - nextRow);
+        StageTimer timer(Stage::binarize);
+        for (int row = 0; row < rows; ++row) {
+            const unsigned char *pixels = getBufferedRow(nextRow + row);
+            Bitmap::Word *bits = bitmap.getRow(y + row);
+            if (bitsPerPixel == 24) {
+                binarizeRow(pixels, bits, imageWidth, threshold);
+            } else if (bitsPerPixel == 8) {
+                binarizeIndexedRow(pixels, bits, imageWidth, black);
+            } else if (black[0] != black[1]) {
+//                the bits are copied as they are when color 1 is black, inverted when color 0 is black
+                unpackMonochromeRow(pixels, bits, imageWidth, black[0]);
+            } else if (black[0]) {
+                bitmap.setRun(y + row, 0, imageWidth);
             }
         }
-        f.ignore(paddingAmount);
+        addStageBytes(Stage::binarize, (std::uint64_t) rowSize * rows,
+                      (std::uint64_t) bitmap.getWordsPerRow() * sizeof(Bitmap::Word) * rows);
+        addStageSymbols(Stage::binarize, (std::uint64_t) imageWidth * rows);
+        nextRow += rows;
+        y += rows;
+        count -= rows;
     }
-    f.close();
+}
+
+void Image::read(std::istream &f, int threshold) {
+    ImageReader reader(f, threshold);
+    fileSize = reader.getFileSize();
+//    create the bitmap to represent the pixels of the image (0 is white, 1 is black) and binarize each row straight
+//    into it
+    bitmap = Bitmap(reader.getImageWidth(), reader.getImageHeight());
+    reader.readRows(bitmap, 0, bitmap.getHeight());
 }
 
 Image::~Image() = default;
 
 int Image::getImageWidth() const {
-    return imageWidth;
+    return bitmap.getWidth();
 }
 
 int Image::getImageHeight() const {
-    return imageHeight;
+    return bitmap.getHeight();
 }
 
-int **Image::getBitImage() const {
-    return bitImage;
+const Bitmap &Image::getBitmap() const {
+    return bitmap;
 }
 
-void Image::setImageWidth(int imageWidthToBeSet) {
-    Image::imageWidth = imageWidthToBeSet;
+void Image::setBitmap(Bitmap &&bitmapToBeSet) {
+    Image::bitmap = std::move(bitmapToBeSet);
 }
 
-void Image::setImageHeight(int imageHeightToBeSet) {
-    Image::imageHeight = imageHeightToBeSet;
+Bitmap Image::releaseBitmap() {
+    return std::move(bitmap);
 }
 
-void Image::setBitImage(int **bitImageToBeSet) {
-    Image::bitImage = bitImageToBeSet;
-}
+void Image::writeImage(std::ostream &f, ImageFormat format) {
+    StageTimer timer(Stage::writeFile);
+    const int imageWidth = bitmap.getWidth();
+    const int imageHeight = bitmap.getHeight();
 
-/// Export the image to a .bmp file.
-/// \param fileName File name of the new .bmp image file.
-void Image::saveImage(const std::string &fileName) {
-    std::ofstream f;
-    f.open(fileName, std::ios::out | std::ios::binary);
-    if (!f.is_open()) {
-        std::cout << "The file could not be opened." << std::endl;
-        exit(1);
+    if (format == ImageFormat::pbm) {
+//        rows of 1-bit pixels from the top, 1 is black, each padded to whole bytes
+        const std::string header = "P4\n" + std::to_string(imageWidth) + " " + std::to_string(imageHeight) + "\n";
+        f.write(header.data(), (std::streamsize) header.size());
+        std::vector<unsigned char> row((imageWidth + 7) / 8);
+        for (int y = 0; y < imageHeight; ++y) {
+            packMonochromeRow(bitmap.getRow(y), row.data(), imageWidth);
+            f.write(reinterpret_cast<char *>(row.data()), (std::streamsize) row.size());
+        }
+        addStageBytes(Stage::writeFile, 0, header.size() + row.size() * imageHeight);
+        return;
     }
 
-//    padding to add
-    unsigned char bmpPad[3] = {0, 0, 0};
-//    amount of padding added at the end of each row of pixels
-    const int paddingAmount = ((4 - (imageWidth * 3) % 4) % 4);
+    const int bitsPerPixel = format == ImageFormat::bmp24 ? 24 : format == ImageFormat::bmp8 ? 8 : 1;
+    const int numberOfColors = bitsPerPixel == 24 ? 0 : 1 << bitsPerPixel;
 //    the number of bytes in a row must be divisible by 4
-//    imageWidth * 3 -> how many bytes in array
-//    imageWidth * 3) % 4 -> how many excess bytes at the end
-//    4 - (imageWidth * 3) % 4 -> how many bytes left
-//    (4 - (imageWidth * 3) % 4) % 4 -> we cannot have 4 padding amount.
-
-    fileSize = fileHeaderSize + informationHeaderSize + imageWidth * imageHeight * 3 + paddingAmount * imageHeight;
+    const std::size_t rowSize = ((std::size_t) imageWidth * bitsPerPixel + 31) / 32 * 4;
+    const int pixelDataOffset = bmpFileHeaderSize + bmpInformationHeaderSize + 4 * numberOfColors;
+    const std::uint64_t imageFileSize = pixelDataOffset + rowSize * imageHeight;
+    if (imageFileSize > UINT32_MAX) throw MidCrackCodeError("The image is too large for a .bmp file.");
+    fileSize = (std::uint32_t) imageFileSize;
+    addStageBytes(Stage::writeFile, 0, imageFileSize);
 
 //    initialize the file header
+    std::fill_n(fileHeader, bmpFileHeaderSize, 0);
     // file type
     fileHeader[0] = 'B';
     fileHeader[1] = 'M';
-    // file size
-    fileHeader[2] = fileSize;
-    fileHeader[3] = fileSize >> 8;
-    fileHeader[4] = fileSize >> 16;
-    fileHeader[5] = fileSize >> 24;
-    // reserved 1 (not used)
-    fileHeader[6] = 0;
-    fileHeader[7] = 0;
-    // reserved 2 (not used)
-    fileHeader[8] = 0;
-    fileHeader[9] = 0;
-    // pixel data offset
-    fileHeader[10] = fileHeaderSize + informationHeaderSize;
-    fileHeader[11] = 0;
-    fileHeader[12] = 0;
-    fileHeader[13] = 0;
-
-//    initialize the information header
+    // file size (the reserved fields that follow are not used)
+    writeNumber(fileHeader + 2, fileSize);
+    // pixel data offset, after the palette
+    writeNumber(fileHeader + 10, pixelDataOffset);
+
+//    initialize the information header; the fields that are not set are 0: no compression, image size (not needed
+//    without compression), pixels per meter (not specified) and important colors (all)
+    std::fill_n(informationHeader, bmpInformationHeaderSize, 0);
     // header size
-    informationHeader[0] = informationHeaderSize;
-    informationHeader[1] = 0;
-    informationHeader[2] = 0;
-    informationHeader[3] = 0;
-    // image width
-    informationHeader[4] = imageWidth;
-    informationHeader[5] = imageWidth >> 8;
-    informationHeader[6] = imageWidth >> 16;
-    informationHeader[7] = imageWidth >> 24;
-    // image height
-    informationHeader[8] = imageHeight;
-    informationHeader[9] = imageHeight >> 8;
-    informationHeader[10] = imageHeight >> 16;
-    informationHeader[11] = imageHeight >> 24;
+    writeNumber(informationHeader, bmpInformationHeaderSize);
+    // image width and height; a positive height stores the rows from the bottom
+    writeNumber(informationHeader + 4, imageWidth);
+    writeNumber(informationHeader + 8, imageHeight);
     // planes
     informationHeader[12] = 1;
-    informationHeader[13] = 0;
-    // bits per pixel (rgb)
-    informationHeader[14] = 24;
-    informationHeader[15] = 0;
-    // compression (no compression)
-    informationHeader[16] = 0;
-    informationHeader[17] = 0;
-    informationHeader[18] = 0;
-    informationHeader[19] = 0;
-    // image size (no compression)
-    informationHeader[20] = 0;
-    informationHeader[21] = 0;
-    informationHeader[22] = 0;
-    informationHeader[23] = 0;
-    // x pixels per meter (not specified)
-    informationHeader[24] = 0;
-    informationHeader[25] = 0;
-    informationHeader[26] = 0;
-    informationHeader[27] = 0;
-    // y pixels per meter (not specified)
-    informationHeader[28] = 0;
-    informationHeader[29] = 0;
-    informationHeader[30] = 0;
-    informationHeader[31] = 0;
-    // total colors (color palette not used)
-    informationHeader[32] = 0;
-    informationHeader[33] = 0;
-    informationHeader[34] = 0;
-    informationHeader[35] = 0;
-    // important colors (generally ignored)
-    informationHeader[32] = 0;
-    informationHeader[33] = 0;
-    informationHeader[34] = 0;
-    informationHeader[35] = 0;
-
-    f.write(reinterpret_cast<char *>(fileHeader), fileHeaderSize);
-    f.write(reinterpret_cast<char *>(informationHeader), informationHeaderSize);
-
-//    go through each pixel in the image
-    int value; // value to add to each color channel of the pixel
-    for (int y = 0; y < imageHeight; ++y) {
-        for (int x = 0; x < imageWidth; ++x) {
-            if (bitImage[y][x] == 1) value = 0; // black
-            else value = 255; // white
-
-            unsigned char color[3]; // create pixel with colors of value (black or white)
-            color[0] = value;
-            color[1] = value;
-            color[2] = value;
-            f.write(reinterpret_cast<char *>(color), 3);
+    // bits per pixel
+    informationHeader[14] = bitsPerPixel;
+    // total colors of the palette
+    writeNumber(informationHeader + 32, numberOfColors);
+
+    f.write(reinterpret_cast<char *>(fileHeader), bmpFileHeaderSize);
+    f.write(reinterpret_cast<char *>(informationHeader), bmpInformationHeaderSize);
+
+//    the palette of 8-bit images is every gray from black, that of 1-bit images is white and black, so the bits of the
+//    bitmap are written as they are
+    std::vector<unsigned char> palette(4 * numberOfColors, 0);
+    for (int color = 0; color < numberOfColors; ++color) {
+        const auto gray = (unsigned char) (bitsPerPixel == 8 ? color : 255 * (1 - color));
+        std::fill_n(&palette[4 * color], 3, gray);
+    }
+    f.write(reinterpret_cast<char *>(palette.data()), (std::streamsize) palette.size());
+
+//    build each row (pixels and padding) in a buffer and write it at once, from the bottom row
+    std::vector<unsigned char> row(rowSize, 0);
+    for (int y = imageHeight - 1; y >= 0; --y) {
+        const Bitmap::Word *bitRow = bitmap.getRow(y);
+        if (bitsPerPixel == 1) {
+            packMonochromeRow(bitRow, row.data(), imageWidth);
+        } else {
+            const int bytesPerPixel = bitsPerPixel / 8;
+            unsigned char *color = row.data();
+            for (int x = 0; x < imageWidth; ++x, color += bytesPerPixel) {
+                // value of each color channel of the pixel (black or white)
+                const bool black = (bitRow[x / Bitmap::bitsPerWord] >> (x % Bitmap::bitsPerWord)) & 1;
+                std::fill_n(color, bytesPerPixel, black ? 0 : 255);
+            }
         }
-        // add padding
-        f.write(reinterpret_cast<char *>(bmpPad), paddingAmount);
+        f.write(reinterpret_cast<char *>(row.data()), (std::streamsize) row.size());
     }
-    f.close();
 }
@@ -5,24 +5,100 @@
 #ifndef MID_CRACK_CODE_IMAGE_H
 #define MID_CRACK_CODE_IMAGE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+#include "Binarize.h"
+#include "Bitmap.h"
+
+/// Formats of the images Image writes. It reads all of them, telling .bmp and .pbm files apart by their first bytes,
+/// and the number of bits per pixel of .bmp files from their header.
+enum class ImageFormat {
+    bmp24, // 24 bits per pixel, black and white
+    bmp8, // 8 bits per pixel with a palette of all the grays
+    bmp1, // 1 bit per pixel with a palette of white and black, the bits of the bitmap as they are
+    pbm // binary portable bitmap (P4), 1 bit per pixel, 1 is black
+};
+
+/// Sizes of the headers of .bmp files.
+const int bmpFileHeaderSize = 14;
+const int bmpInformationHeaderSize = 40;
+
+/// Reads the pixels of a .bmp or .pbm image as binarized rows from the top, a few rows of the file at a time, so an
+/// image can be processed without having all its pixels in memory. Rows of .bmp files that are stored from the bottom
+/// are read from the end of the file. With Otsu's method, the whole file is read once more to find the threshold
+/// before the first row.
+class ImageReader {
+private:
+//    how many bytes of pixel data are read from the file at once
+    static const int readBufferSize = 1 << 22;
+    std::istream &f;
+    int imageWidth{}, imageHeight{}, bitsPerPixel{};
+    std::uint32_t fileSize{};
+    bool bottomUp{}; // the last row of the image is stored first
+    std::size_t rowSize{}; // bytes of a row of pixels with its padding
+    std::streamoff pixelDataOffset{};
+//    luminance of each color of the palette of 1-bit and 8-bit images
+    std::uint64_t luminance[256]{};
+    int threshold;
+    bool black[256]{}; // colors of the palette that are black
+//    rows [bufferFirstRow, bufferFirstRow + bufferRows) of the image that are read from the file
+    std::vector<unsigned char> buffer;
+    int rowsPerRead{};
+    int bufferFirstRow{}, bufferRows{};
+    int nextRow{}; // next row of readRows
+
+    void readHeader();
+
+    void fillBuffer(int firstRow);
+
+    [[nodiscard]] const unsigned char *getBufferedRow(int y) const;
+
+public:
+    /// Read the headers of the image.
+    /// \param threshold Pixels with luminance below the threshold are black (otsuThreshold computes it from the image).
+    /// \throw MidCrackCodeError If the image is not a supported .bmp or .pbm image, or it is truncated.
+    ImageReader(std::istream &f, int threshold);
+
+    [[nodiscard]] int getImageWidth() const { return imageWidth; }
+
+    [[nodiscard]] int getImageHeight() const { return imageHeight; }
+
+    /// \return Size of the file in its .bmp header, 0 for .pbm images.
+    [[nodiscard]] std::uint32_t getFileSize() const { return fileSize; }
+
+    /// Binarize the next rows of the image into rows of a bitmap as wide as the image.
+    /// \param y First row of bitmap to binarize into; the rows must be white.
+    /// \param count Number of rows, at most the number of rows of the image that are not read yet.
+    /// \throw MidCrackCodeError If the image is truncated.
+    void readRows(Bitmap &bitmap, int y, int count);
+};
 
 class Image {
 private:
-    int fileSize{};
-    int imageWidth{};
-    int imageHeight{};
-//    2D array to represent the pixels of the image (0 is white, 1 is black)
-    int **bitImage{};
-//    header sizes
-    static const int fileHeaderSize = 14;
-    static const int informationHeaderSize = 40;
+    std::uint32_t fileSize{};
+//    pixels of the image (0 is white, 1 is black)
+    Bitmap bitmap;
 //    headers
-    unsigned char fileHeader[fileHeaderSize]{};
-    unsigned char informationHeader[informationHeaderSize]{};
+    unsigned char fileHeader[bmpFileHeaderSize]{};
+    unsigned char informationHeader[bmpInformationHeaderSize]{};
+
+    void read(std::istream &f, int threshold);
 public:
     Image();
 
-    explicit Image(const char *imageFilePath);
+    /// Read a .bmp or .pbm image from memory, like the constructor that reads a stream.
+    explicit Image(std::span<const unsigned char> bytes, int threshold = defaultThreshold);
+
+    /// Preprocess image (convert image file into a data structure for further use).
+    /// \param f Stream that can seek with a .bmp image without compression with 24 bits per pixel (rgb color space and
+    /// no alpha channel), or 1 or 8 bits per pixel with a palette, or a binary .pbm image.
+    /// \param threshold Pixels with luminance below the threshold are black (otsuThreshold computes it from the image).
+    explicit Image(std::istream &f, int threshold = defaultThreshold);
 
     virtual ~Image();
 
@@ -30,15 +106,16 @@ public:
 
     [[nodiscard]] int getImageHeight() const;
 
-    [[nodiscard]] int **getBitImage() const;
-
-    void setImageWidth(int imageWidthToBeSet);
+    [[nodiscard]] const Bitmap &getBitmap() const;
 
-    void setImageHeight(int imageHeightToBeSet);
+    void setBitmap(Bitmap &&bitmapToBeSet);
 
-    void setBitImage(int **bitImageToBeSet);
+    /// Move the bitmap out of the image, which is left empty.
+    Bitmap releaseBitmap();
 
-    void saveImage(const std::string &fileName);
+    /// Write the image to a stream as a .bmp or .pbm image.
+    /// \throw MidCrackCodeError If a .bmp file of the image would be larger than its 32-bit file size.
+    void writeImage(std::ostream &f, ImageFormat format = ImageFormat::bmp24);
 };
 
 
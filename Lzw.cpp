@@ -0,0 +1,193 @@
+#include "Lzw.h"
+#include "BitStream.h"
+#include "Stats.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+//    first code of a string with more than one digit in each format
+    const std::size_t legacyFirstCode = 8;
+    const std::size_t variableWidthFirstCode = 10;
+}
+
+int getLzwCodeWidth(std::size_t codesSinceReset, int maxCodeWidth, std::size_t primedStrings) {
+//    the encoder adds a string to the dictionary with every code, so the largest code that can follow is the number of
+//    codes in the dictionary - 1
+    const std::size_t dictionarySize = std::min(variableWidthFirstCode + primedStrings + codesSinceReset,
+                                                std::size_t(1) << maxCodeWidth);
+    return std::max(lzwMinCodeWidth, (int) std::bit_width(dictionarySize - 1));
+}
+
+LzwEncoder::LzwEncoder() : firstCode(legacyFirstCode), maxDictionarySize(0), resetWhenFull(false) {
+    clear();
+}
+
+LzwEncoder::LzwEncoder(int maxCodeWidth, bool resetWhenFull, const LzwDictionary *dictionary)
+        : firstCode(variableWidthFirstCode), maxDictionarySize(std::size_t(1) << maxCodeWidth),
+          resetWhenFull(resetWhenFull), dictionary(dictionary) {
+    clear();
+}
+
+void LzwEncoder::clear() {
+    children.resize(firstCode);
+    for (auto &codes : children) codes.fill(noCode);
+    if (dictionary == nullptr) return;
+    for (const auto &entry : dictionary->getEntries()) {
+        children[entry.prefixCode][entry.lastDigit] = (int) children.size();
+        children.emplace_back().fill(noCode);
+    }
+}
+
+void LzwEncoder::addDigit(int digit, std::vector<unsigned> &codes) {
+    if (currentCode == noCode) { // first digit
+        currentCode = digit;
+        return;
+    }
+    const int extendedCode = children[currentCode][digit];
+    if (extendedCode != noCode) { // current string + digit is in the dictionary
+        currentCode = extendedCode;
+        return;
+    }
+//    output the code of the current string, add current string + digit to the dictionary and start again at digit
+    codes.push_back(currentCode);
+    if (maxDictionarySize == 0 || children.size() < maxDictionarySize) {
+        children[currentCode][digit] = (int) children.size();
+        children.emplace_back().fill(noCode);
+    } else if (resetWhenFull) {
+        codes.push_back(lzwClearCode);
+        clear();
+    }
+    currentCode = digit;
+}
+
+void LzwEncoder::finish(std::vector<unsigned> &codes) {
+    if (currentCode != noCode) codes.push_back(currentCode);
+    currentCode = noCode;
+}
+
+LzwDecoder::LzwDecoder() : firstCode(legacyFirstCode), maxDictionarySize(0) {
+    clear();
+}
+
+LzwDecoder::LzwDecoder(int maxCodeWidth, const LzwDictionary *dictionary)
+        : firstCode(variableWidthFirstCode), maxDictionarySize(std::size_t(1) << maxCodeWidth), dictionary(dictionary) {
+    clear();
+}
+
+void LzwDecoder::clear() {
+//    single digits; the codes between 8 and firstCode are not strings and have length 0
+    table.assign(firstCode, {noCode, 0, 0});
+    for (std::uint32_t digit = 0; digit < 8; ++digit) table[digit] = {noCode, 1, (unsigned char) digit};
+    if (dictionary != nullptr) {
+        for (const auto &entry : dictionary->getEntries()) {
+            table.push_back({entry.prefixCode, table[entry.prefixCode].length + 1, entry.lastDigit});
+        }
+    }
+    previousCode = noCode;
+}
+
+std::size_t LzwDecoder::getLength(unsigned code) const {
+    if (previousCode == noCode) return code < table.size() ? table[code].length : 0; // first code after a clear
+    if (code < table.size()) return table[code].length;
+//    the code was added by the encoder with its previous code, so it is the previous string + its first digit
+    const bool tableIsFull = maxDictionarySize != 0 && table.size() >= maxDictionarySize;
+    return code == table.size() && !tableIsFull ? table[previousCode].length + 1 : 0;
+}
+
+template<typename WriteDigit>
+std::size_t LzwDecoder::expandCode(unsigned code, WriteDigit writeDigit) {
+    const std::size_t length = getLength(code);
+    if (length == 0) return 0;
+    bool addString = previousCode != noCode && (maxDictionarySize == 0 || table.size() < maxDictionarySize);
+    if (code == table.size()) { // the previous string + its first digit, which is the string of this code
+        table.push_back({previousCode, table[previousCode].length + 1, previousFirstDigit});
+        addString = false;
+    }
+
+//    write the digits from the last one to the first one
+    std::uint32_t current = code;
+    unsigned char digit{};
+    for (std::size_t i = length; i-- > 0;) {
+        digit = table[current].lastDigit;
+        writeDigit(i, digit);
+        current = table[current].prefixCode;
+    }
+
+//    add the previous string + the first digit of this one
+    if (addString) {
+        table.push_back({previousCode, table[previousCode].length + 1, digit});
+    }
+    previousCode = code;
+    previousFirstDigit = digit;
+    return length;
+}
+
+std::size_t LzwDecoder::addCode(unsigned code, unsigned char *output) {
+    return expandCode(code, [output](std::size_t i, unsigned char digit) { output[i] = digit; });
+}
+
+bool LzwDecoder::addCode(unsigned code, ChainCode &output) {
+    const std::size_t start = output.size();
+    output.grow(getLength(code));
+    return expandCode(code, [&output, start](std::size_t i, unsigned char digit) { output.set(start + i, digit); });
+}
+
+void encodeLzwBits(const ChainCode &digits, std::size_t first, std::size_t count, int maxCodeWidth, bool resetWhenFull,
+                   const LzwDictionary *dictionary, std::vector<unsigned char> &bytes) {
+    std::vector<unsigned> codes;
+    LzwEncoder encoder(maxCodeWidth, resetWhenFull, dictionary);
+    const std::size_t primedStrings = dictionary == nullptr ? 0 : dictionary->getEntries().size();
+    for (std::size_t i = first; i < first + count; ++i) encoder.addDigit(digits[i], codes);
+    encoder.finish(codes);
+    codes.push_back(lzwEndCode);
+
+    BitWriter writer(bytes);
+    std::size_t codesSinceReset = 0;
+    for (unsigned code : codes) {
+        writer.write(code, getLzwCodeWidth(codesSinceReset, maxCodeWidth, primedStrings));
+        codesSinceReset = code == lzwClearCode ? 0 : codesSinceReset + 1;
+    }
+    writer.flush();
+    recordLzwDictionary(encoder.getDictionarySize(), getLzwCodeWidth(codesSinceReset, maxCodeWidth, primedStrings));
+}
+
+namespace {
+    /// Read the codes up to the end code and write the digits of each code with writeCode(decoder, code).
+    template<typename WriteCode>
+    bool decodeLzwCodes(const unsigned char *bytes, std::size_t size, int maxCodeWidth, const LzwDictionary *dictionary,
+                        WriteCode writeCode) {
+        BitReader reader(bytes, size);
+        LzwDecoder decoder(maxCodeWidth, dictionary);
+        const std::size_t primedStrings = dictionary == nullptr ? 0 : dictionary->getEntries().size();
+        std::size_t codesSinceReset = 0;
+        std::uint32_t code;
+        while (reader.read(code, getLzwCodeWidth(codesSinceReset, maxCodeWidth, primedStrings))) {
+            if (code == lzwEndCode) return true;
+            if (code == lzwClearCode) {
+                decoder.clear();
+                codesSinceReset = 0;
+                continue;
+            }
+            if (!writeCode(decoder, code)) return false;
+            ++codesSinceReset;
+        }
+        return false; // no end code
+    }
+}
+
+bool decodeLzwBits(const unsigned char *bytes, std::size_t size, int maxCodeWidth, ChainCode &digits) {
+    return decodeLzwCodes(bytes, size, maxCodeWidth, nullptr, [&](LzwDecoder &decoder, std::uint32_t code) {
+        return decoder.addCode(code, digits);
+    });
+}
+
+bool decodeLzwBits(const unsigned char *bytes, std::size_t size, int maxCodeWidth, const LzwDictionary *dictionary,
+                   unsigned char *digits, std::size_t capacity, std::size_t &length) {
+    length = 0;
+    return decodeLzwCodes(bytes, size, maxCodeWidth, dictionary, [&](LzwDecoder &decoder, std::uint32_t code) {
+        const std::size_t codeLength = decoder.getLength(code);
+        if (codeLength == 0 || codeLength > capacity - length) return false;
+        length += decoder.addCode(code, digits + length);
+        return true;
+    });
+}
@@ -0,0 +1,132 @@
+#ifndef MID_CRACK_CODE_LZW_H
+#define MID_CRACK_CODE_LZW_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ChainCode.h"
+#include "LzwDictionary.h"
+
+/// Reserved codes of the variable width format.
+const unsigned lzwClearCode = 8; // the dictionary is reset to the single digits and the LzwDictionary
+const unsigned lzwEndCode = 9; // there are no more codes
+/// Limits of the width of the codes of the variable width format in bits.
+const int lzwMinCodeWidth = 4;
+const int lzwMaxCodeWidth = 24;
+const int lzwDefaultMaxCodeWidth = 16;
+
+/// Width in bits of the next code of the variable width format. The width grows from 4 bits with the dictionary, until
+/// the dictionary has 2^maxCodeWidth codes.
+/// \param codesSinceReset Number of codes written since the start or the last clear code.
+/// \param primedStrings Number of strings of the LzwDictionary the dictionary starts with.
+int getLzwCodeWidth(std::size_t codesSinceReset, int maxCodeWidth, std::size_t primedStrings = 0);
+
+/// LZW encoder over the digits 0-7 of mid-crack codes.
+/// Codes 0-7 are the single digits; every new string gets the next code. The dictionary is a trie with 8 children per
+/// code, so extending the current string by a digit is a single table lookup.
+class LzwEncoder {
+private:
+    static constexpr int noCode = -1;
+//    children[code][digit] is the code of the string of code followed by digit
+    std::vector<std::array<int, 8>> children;
+//    code of the longest string in the dictionary that matches the end of the input
+    int currentCode = noCode;
+    std::size_t firstCode; // code of the first string with more than one digit
+    std::size_t maxDictionarySize; // 0 for no limit
+    bool resetWhenFull;
+    const LzwDictionary *dictionary = nullptr;
+
+    void clear();
+
+public:
+    /// Encoder of the legacy format, where the dictionary grows without a limit.
+    LzwEncoder();
+
+    /// Encoder of the variable width format, which reserves the codes 8 and 9.
+    /// \param maxCodeWidth The dictionary stops growing at 2^maxCodeWidth codes.
+    /// \param resetWhenFull Add a clear code and start with an empty dictionary when it is full, instead of keeping the
+    /// full dictionary until the end.
+    /// \param dictionary Strings the dictionary starts with after every clear code, if not null; it has to outlive the
+    /// encoder and have fewer than 2^maxCodeWidth - 10 strings.
+    LzwEncoder(int maxCodeWidth, bool resetWhenFull, const LzwDictionary *dictionary = nullptr);
+
+    /// Add a digit of the input.
+    /// \param codes The code of the current string is added to codes when the string can not be extended by the digit.
+    void addDigit(int digit, std::vector<unsigned> &codes);
+
+    /// Add the code of the rest of the input to codes.
+    void finish(std::vector<unsigned> &codes);
+
+    [[nodiscard]] std::size_t getDictionarySize() const { return children.size(); }
+};
+
+/// LZW decoder of the codes written by LzwEncoder.
+/// Every string of the dictionary is stored as the code of the string without its last digit, the last digit and the
+/// length, so adding a string does not allocate memory and the memory depends only on the number of strings. The digits
+/// of a code are written from the last one to the first one by following the codes of the shorter strings.
+class LzwDecoder {
+private:
+    static constexpr std::uint32_t noCode = UINT32_MAX;
+    struct Entry {
+        std::uint32_t prefixCode; // string without the last digit
+        std::uint32_t length;
+        unsigned char lastDigit;
+    };
+    std::vector<Entry> table;
+    std::uint32_t previousCode = noCode;
+    unsigned char previousFirstDigit{};
+    std::size_t firstCode;
+    std::size_t maxDictionarySize;
+    const LzwDictionary *dictionary = nullptr;
+
+//    write the digits of a code with writeDigit(index, digit), from the last one to the first one, and update the
+//    dictionary; returns the number of digits, 0 if the code is not in the dictionary
+    template<typename WriteDigit>
+    std::size_t expandCode(unsigned code, WriteDigit writeDigit);
+
+public:
+    /// Decoder of the legacy format.
+    LzwDecoder();
+
+    /// Decoder of the variable width format. The clear and end codes are handled by the caller.
+    /// \param dictionary Strings the dictionary starts with, like those of the encoder.
+    explicit LzwDecoder(int maxCodeWidth, const LzwDictionary *dictionary = nullptr);
+
+    /// \return Number of digits of the next code, 0 if the code is not in the dictionary.
+    [[nodiscard]] std::size_t getLength(unsigned code) const;
+
+    /// Write the digits of the next code to output, one digit per byte.
+    /// \param output Has space for at least getLength(code) digits.
+    /// \return Number of digits, 0 if the code is not in the dictionary.
+    std::size_t addCode(unsigned code, unsigned char *output);
+
+    /// Append the digits of the next code to output.
+    /// \return False if the code is not in the dictionary.
+    bool addCode(unsigned code, ChainCode &output);
+
+    /// Start again with the dictionary of single digits and the strings of the LzwDictionary.
+    void clear();
+};
+
+/// Compress the digits [first, first + count) of a chain code into codes of the variable width format, ending with the
+/// end code.
+/// \param dictionary Strings the dictionary starts with, if not null.
+/// \param bytes The codes are appended to bytes, least significant bit first.
+void encodeLzwBits(const ChainCode &digits, std::size_t first, std::size_t count, int maxCodeWidth, bool resetWhenFull,
+                   const LzwDictionary *dictionary, std::vector<unsigned char> &bytes);
+
+/// Decompress codes of the variable width format up to the end code.
+/// \param digits The digits are appended to digits.
+/// \return False if the codes are corrupted.
+bool decodeLzwBits(const unsigned char *bytes, std::size_t size, int maxCodeWidth, ChainCode &digits);
+
+/// Decompress codes of the variable width format up to the end code into a buffer of known size, one digit per byte.
+/// \param dictionary Strings the dictionary of the encoder started with, if not null.
+/// \param length Number of digits written to digits.
+/// \return False if the codes are corrupted or there are more than capacity digits.
+bool decodeLzwBits(const unsigned char *bytes, std::size_t size, int maxCodeWidth, const LzwDictionary *dictionary,
+                   unsigned char *digits, std::size_t capacity, std::size_t &length);
+
+
+#endif //MID_CRACK_CODE_LZW_H
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include "Error.h"
+#include "LzwDictionary.h"
+
+namespace {
+//    code of the first string of a dictionary, after the single digits and the reserved codes
+    const std::uint32_t firstStringCode = 10;
+//    largest number of strings of the dictionary of a trainer
+    const std::size_t trainingMaxStrings = std::size_t(1) << 20;
+    const std::size_t headerSize = 12;
+    const std::size_t entrySize = 5;
+
+//    FNV-1a hash of the entries
+    std::uint32_t hashEntries(const std::vector<LzwDictionary::Entry> &entries) {
+        std::uint32_t hash = 2166136261u;
+        const auto addByte = [&hash](unsigned char byte) { hash = (hash ^ byte) * 16777619u; };
+        for (const auto &entry : entries) {
+            for (int byte = 0; byte < 4; ++byte) addByte((unsigned char) (entry.prefixCode >> (8 * byte)));
+            addByte(entry.lastDigit);
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    std::uint32_t readNumber(const unsigned char *bytes) {
+        return bytes[0] | std::uint32_t(bytes[1]) << 8 | std::uint32_t(bytes[2]) << 16 | std::uint32_t(bytes[3]) << 24;
+    }
+
+    void writeNumber(std::vector<unsigned char> &bytes, std::uint32_t value) {
+        for (int byte = 0; byte < 4; ++byte) bytes.push_back((unsigned char) (value >> (8 * byte)));
+    }
+}
+
+LzwDictionary::LzwDictionary(std::vector<Entry> entries) : entries(std::move(entries)) {
+    for (std::size_t i = 0; i < this->entries.size(); ++i) {
+        const Entry &entry = this->entries[i];
+        const bool singleDigit = entry.prefixCode < 8;
+        const bool earlierString = entry.prefixCode >= firstStringCode && entry.prefixCode < firstStringCode + i;
+        if ((!singleDigit && !earlierString) || entry.lastDigit > 7) {
+            throw MidCrackCodeError("The LZW dictionary is corrupted.");
+        }
+    }
+    id = hashEntries(this->entries);
+}
+
+LzwDictionaryTrainer::LzwDictionaryTrainer() {
+    children.resize(8);
+    for (auto &codes : children) codes.fill(noCode);
+    prefixes.assign(8, noCode);
+    uses.assign(8, 0);
+}
+
+void LzwDictionaryTrainer::addChain(const ChainCode &code) {
+    if (code.size() == 0) return;
+    std::uint32_t current = code[0];
+    for (std::size_t i = 1; i < code.size(); ++i) {
+        const int digit = code[i];
+        if (children[current][digit] != noCode) {
+            current = children[current][digit];
+            continue;
+        }
+//        end the string, learn it followed by the digit and start again at the digit
+        ++uses[current];
+        if (children.size() < trainingMaxStrings) {
+            children[current][digit] = (std::uint32_t) children.size();
+            children.emplace_back().fill(noCode);
+            prefixes.push_back(current);
+            uses.push_back(0);
+        }
+        current = digit;
+    }
+    ++uses[current];
+}
+
+LzwDictionary LzwDictionaryTrainer::train(std::size_t numberOfStrings) const {
+//    number of split strings each string begins; a string is learned after its prefix, so adding the strings from the
+//    last one to their prefixes sums the whole subtree of each string
+    std::vector<std::uint64_t> starts = uses;
+    std::vector<std::uint32_t> lengths(children.size(), 1);
+    for (std::size_t string = children.size(); string-- > 8;) starts[prefixes[string]] += starts[string];
+    for (std::size_t string = 8; string < children.size(); ++string) lengths[string] = lengths[prefixes[string]] + 1;
+
+//    most used strings first; a prefix is used at least as often and is shorter, so it comes before its extensions
+    std::vector<std::uint32_t> strings(children.size() - 8);
+    std::iota(strings.begin(), strings.end(), 8);
+    std::sort(strings.begin(), strings.end(), [&](std::uint32_t a, std::uint32_t b) {
+        if (starts[a] != starts[b]) return starts[a] > starts[b];
+        return lengths[a] != lengths[b] ? lengths[a] < lengths[b] : a < b;
+    });
+
+    std::vector<std::uint32_t> codes(children.size());
+    std::iota(codes.begin(), codes.begin() + 8, 0);
+    std::vector<LzwDictionary::Entry> entries;
+    for (std::uint32_t string : strings) {
+        if (entries.size() == numberOfStrings || starts[string] == 0) break;
+        codes[string] = firstStringCode + (std::uint32_t) entries.size();
+        const std::uint32_t prefix = prefixes[string];
+        for (int digit = 0; digit < 8; ++digit) {
+            if (children[prefix][digit] == string) entries.push_back({codes[prefix], (unsigned char) digit});
+        }
+    }
+    return LzwDictionary(std::move(entries));
+}
+
+void writeLzwDictionary(const LzwDictionary &dictionary, std::vector<unsigned char> &bytes) {
+    bytes.assign(lzwDictionaryMagic, lzwDictionaryMagic + 3);
+    bytes.push_back(lzwDictionaryVersion);
+    writeNumber(bytes, dictionary.getId());
+    writeNumber(bytes, (std::uint32_t) dictionary.getEntries().size());
+    for (const auto &entry : dictionary.getEntries()) {
+        writeNumber(bytes, entry.prefixCode);
+        bytes.push_back(entry.lastDigit);
+    }
+}
+
+LzwDictionary parseLzwDictionary(std::span<const unsigned char> bytes) {
+    if (bytes.size() < headerSize || !std::equal(lzwDictionaryMagic, lzwDictionaryMagic + 3, bytes.begin())) {
+        throw MidCrackCodeError("The file is not an LZW dictionary.");
+    }
+    if (bytes[3] != lzwDictionaryVersion) {
+        throw MidCrackCodeError("Unsupported version of the LZW dictionary.");
+    }
+    const std::uint32_t id = readNumber(bytes.data() + 4);
+    const std::uint32_t numberOfEntries = readNumber(bytes.data() + 8);
+    if ((bytes.size() - headerSize) / entrySize != numberOfEntries || (bytes.size() - headerSize) % entrySize != 0) {
+        throw MidCrackCodeError("The LZW dictionary is corrupted.");
+    }
+    std::vector<LzwDictionary::Entry> entries(numberOfEntries);
+    for (std::uint32_t i = 0; i < numberOfEntries; ++i) {
+        const unsigned char *entry = bytes.data() + headerSize + i * entrySize;
+        entries[i] = {readNumber(entry), entry[4]};
+    }
+    LzwDictionary dictionary(std::move(entries));
+    if (dictionary.getId() != id) throw MidCrackCodeError("The LZW dictionary is corrupted.");
+    return dictionary;
+}
@@ -0,0 +1,76 @@
+#ifndef MID_CRACK_CODE_LZWDICTIONARY_H
+#define MID_CRACK_CODE_LZWDICTIONARY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "ChainCode.h"
+
+/// Start of every LZW dictionary file, followed by the version.
+const unsigned char lzwDictionaryMagic[3] = {'M', 'C', 'D'};
+const unsigned char lzwDictionaryVersion = 1;
+/// Number of strings of a trained dictionary; with the single digits and the reserved codes, the codes start with
+/// 12 bits.
+const std::size_t lzwDefaultDictionaryStrings = 4086;
+
+/// Strings the dictionary of the LZW codes of variable width starts with besides the single digits, learned from chain
+/// codes like the ones that are compressed. Short chains end before an empty dictionary learns their common strings,
+/// so starting with these strings gives fewer codes.
+/// Every string is a single digit or an earlier string followed by a digit, so the strings are added to the dictionary
+/// like the ones the encoder and decoder learn; the string i gets the code 10 + i, after the reserved codes.
+class LzwDictionary {
+public:
+    struct Entry {
+        std::uint32_t prefixCode; // code of the string without its last digit
+        unsigned char lastDigit;
+    };
+
+private:
+    std::vector<Entry> entries;
+    std::uint32_t id;
+
+public:
+    /// \throw MidCrackCodeError If an entry does not extend a single digit or an earlier entry.
+    explicit LzwDictionary(std::vector<Entry> entries);
+
+    [[nodiscard]] const std::vector<Entry> &getEntries() const { return entries; }
+
+    /// \return Hash of the strings, which is never 0; a compressed mid-crack code stores it to find its dictionary.
+    [[nodiscard]] std::uint32_t getId() const { return id; }
+};
+
+/// Learns the strings of an LZW dictionary from chain codes.
+/// Every chain is split into LZW strings from its start, with one dictionary for all the chains that grows up to
+/// 2^20 strings. The strings that begin the most of the split strings are kept; a string begins at least as many as
+/// the longer strings that extend it, so every kept string extends a single digit or another kept string.
+class LzwDictionaryTrainer {
+private:
+    static constexpr std::uint32_t noCode = UINT32_MAX;
+//    children[string][digit] is the string followed by digit; the strings 0-7 are the single digits
+    std::vector<std::array<std::uint32_t, 8>> children;
+    std::vector<std::uint32_t> prefixes;
+    std::vector<std::uint64_t> uses; // number of times the chains were split at the end of the string
+
+public:
+    LzwDictionaryTrainer();
+
+    void addChain(const ChainCode &code);
+
+    /// \param numberOfStrings Largest number of strings besides the single digits; the strings that were never used
+    /// are left out.
+    [[nodiscard]] LzwDictionary train(std::size_t numberOfStrings) const;
+};
+
+/// Write an LZW dictionary file: magic, version 1, ID (uint32), number of strings (uint32), then the code of the
+/// prefix (uint32) and the last digit (uint8) of every string. All numbers are little-endian.
+/// \param bytes The file replaces its content.
+void writeLzwDictionary(const LzwDictionary &dictionary, std::vector<unsigned char> &bytes);
+
+/// Read an LZW dictionary file.
+/// \throw MidCrackCodeError If it is not a valid dictionary file.
+LzwDictionary parseLzwDictionary(std::span<const unsigned char> bytes);
+
+
+#endif //MID_CRACK_CODE_LZWDICTIONARY_H
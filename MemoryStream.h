@@ -0,0 +1,57 @@
+#ifndef MID_CRACK_CODE_MEMORYSTREAM_H
+#define MID_CRACK_CODE_MEMORYSTREAM_H
+
+#include <cstddef>
+#include <span>
+#include <streambuf>
+#include <vector>
+
+/// Stream buffer that reads a block of memory without copying it, so code that reads streams can read from memory.
+class MemoryInputBuffer final : public std::streambuf {
+public:
+    explicit MemoryInputBuffer(std::span<const unsigned char> bytes) {
+        char *begin = const_cast<char *>(reinterpret_cast<const char *>(bytes.data()));
+        setg(begin, begin, begin + bytes.size());
+    }
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir origin, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        const off_type base = origin == std::ios_base::beg ? 0 : origin == std::ios_base::cur ? gptr() - eback()
+                                                                                              : egptr() - eback();
+        const off_type position = base + offset;
+        if (position < 0 || position > egptr() - eback()) return pos_type(off_type(-1));
+        setg(eback(), eback() + position, egptr());
+        return pos_type(position);
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+        return seekoff(off_type(position), std::ios_base::beg, which);
+    }
+};
+
+/// Stream buffer that appends everything written to it to a vector of bytes.
+class VectorOutputBuffer final : public std::streambuf {
+private:
+    std::vector<unsigned char> &bytes;
+
+public:
+    explicit VectorOutputBuffer(std::vector<unsigned char> &bytes) : bytes(bytes) {}
+
+protected:
+    std::streamsize xsputn(const char *data, std::streamsize count) override {
+        bytes.insert(bytes.end(), reinterpret_cast<const unsigned char *>(data),
+                     reinterpret_cast<const unsigned char *>(data) + count);
+        return count;
+    }
+
+    int_type overflow(int_type character) override {
+        if (!traits_type::eq_int_type(character, traits_type::eof())) {
+            bytes.push_back((unsigned char) traits_type::to_char_type(character));
+        }
+        return traits_type::not_eof(character);
+    }
+};
+
+
+#endif //MID_CRACK_CODE_MEMORYSTREAM_H
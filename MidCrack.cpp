@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <bit>
+#include <exception>
+#include <istream>
+#include <new>
+#include <ostream>
+#include <string_view>
+#include "BlockContainer.h"
+#include "ContourTracer.h"
+#include "Error.h"
+#include "Image.h"
+#include "MemoryStream.h"
+#include "MidCrack.h"
+#include "Reconstruction.h"
+#include "Stats.h"
+
+namespace {
+//    run a call and turn the errors it throws into a status
+    template<typename Call>
+    MidCrackStatus runCall(Call call) {
+        try {
+            call();
+            return {};
+        } catch (const MidCrackCodeError &error) {
+            return {error.getExitCode(), error.what()};
+        } catch (const std::bad_alloc &) {
+            return {1, "Not enough memory."};
+        } catch (const std::exception &error) {
+            return {1, error.what()};
+        }
+    }
+
+//    the legacy format has no header, so only a single chain whose image the decompression can find again fits in it:
+//    a chain without an image size, or a chain on the top edge of the top row of its own bounding box like the ones of
+//    traceFirstContour
+    bool fitsLegacyFormat(const MidCrackCode &midCrackCode) {
+        if (midCrackCode.chains.size() != 1) return false;
+        if (midCrackCode.imageWidth == 0) return true;
+        const MidCrackChain &chain = midCrackCode.chains[0];
+        if (chain.startDirection != 2 || chain.startY != 0 || chain.code.empty()) return false;
+        MidCrackCode boundingBox;
+        boundingBox.chains.emplace_back();
+        ChainBounds bounds;
+        for (std::size_t i = 0; i < chain.code.size(); ++i) bounds.push_back(chain.code[i]);
+        try {
+            bounds.setImageOf(boundingBox);
+        } catch (const MidCrackCodeError &) { // the chain goes above its start
+            return false;
+        }
+        return boundingBox.imageWidth == midCrackCode.imageWidth &&
+               boundingBox.imageHeight == midCrackCode.imageHeight && boundingBox.chains[0].startX == chain.startX;
+    }
+
+//    legacy format: the number of bytes of each code, then the LZW codes of a single chain in little-endian order,
+//    with a dictionary that grows without a limit
+    void compressLegacy(const MidCrackCode &midCrackCode, std::vector<unsigned char> &output) {
+        if (!fitsLegacyFormat(midCrackCode)) {
+            throw MidCrackCodeError("Only mid-crack codes of a single chain can be compressed in the legacy format.");
+        }
+        StageTimer timer(Stage::encode);
+        std::vector<unsigned> codes;
+        LzwEncoder encoder;
+        const ChainCode &digits = midCrackCode.chains[0].code;
+        for (std::size_t i = 0; i < digits.size(); ++i) encoder.addDigit(digits[i], codes);
+        encoder.finish(codes);
+
+//        number of bytes of the largest code
+        const unsigned largestCode = codes.empty() ? 0 : *std::max_element(codes.begin(), codes.end());
+        const unsigned char numberOfBytesInCode =
+                codes.empty() ? 0 : std::max(1, ((int) std::bit_width(largestCode) + 7) / 8);
+        output.push_back(numberOfBytesInCode);
+        for (auto code : codes) {
+            for (int byte = 0; byte < numberOfBytesInCode; ++byte) {
+                output.push_back((unsigned char) (code >> (8 * byte)));
+            }
+        }
+        recordLzwDictionary(encoder.getDictionarySize(), 8 * numberOfBytesInCode);
+        addStageSymbols(Stage::encode, digits.size());
+        addStageBytes(Stage::encode, 0, output.size());
+    }
+
+    void decompressWhole(std::span<const unsigned char> compressed, MidCrackCode &midCrackCode, ThreadPool &pool,
+                         const std::shared_ptr<const LzwDictionary> &dictionary) {
+        const bool variableWidth = compressed.size() >= 4 &&
+                                   std::equal(compressedMagic, compressedMagic + 3, compressed.begin());
+        if (variableWidth && !isBlockContainer(compressed) && compressed[3] != singleStreamVersion) {
+            throw MidCrackCodeError("Unsupported version of the compressed mid-crack code.");
+        }
+        if (!decompressMidCrackCode(compressed, midCrackCode, pool, dictionary)) {
+            throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+        }
+    }
+}
+
+MidCrackEncoder::MidCrackEncoder(const MidCrackEncoderOptions &options, unsigned numberOfThreads)
+        : options(options), ownPool(std::make_unique<ThreadPool>(numberOfThreads)), pool(*ownPool) {}
+
+MidCrackEncoder::MidCrackEncoder(const MidCrackEncoderOptions &options, ThreadPool &pool)
+        : options(options), pool(pool) {}
+
+MidCrackStatus MidCrackEncoder::trace(const Bitmap &bitmap, MidCrackCode &midCrackCode) {
+    return runCall([&] {
+        const TracingSettings &settings = options.tracing;
+        if (settings.engine == TracingEngine::tiled) {
+//            trace the contours in stripes of the image in parallel
+            midCrackCode = traceContoursTiled(bitmap, settings.allContours, settings.holes, pool,
+                                              settings.stripeHeight);
+            if (midCrackCode.chains.empty()) midCrackCode.chains.emplace_back(); // no black pixels
+        } else if (settings.engine == TracingEngine::stream) {
+//            trace the rows of the image one stripe after the other
+            midCrackCode = traceContoursStreaming(bitmap.getWidth(), bitmap.getHeight(), getRowReader(bitmap),
+                                                  settings.allContours, settings.holes, settings.stripeHeight);
+        } else if (settings.allContours) {
+//            trace the contours of all the objects in parallel
+            midCrackCode = traceAllContours(bitmap, settings.holes, pool);
+        } else {
+//            the mid-crack code of the first object in its bounding box
+            midCrackCode = traceFirstContour(bitmap);
+        }
+    });
+}
+
+MidCrackStatus MidCrackEncoder::trace(std::istream &image, int threshold, MidCrackCode &midCrackCode) {
+    return runCall([&] {
+        const TracingSettings &settings = options.tracing;
+        if (settings.engine != TracingEngine::stream) {
+            const MidCrackStatus status = trace(Image(image, threshold).getBitmap(), midCrackCode);
+            if (!status.ok()) throw MidCrackCodeError(status.message, status.code);
+            return;
+        }
+        ImageReader reader(image, threshold);
+        midCrackCode = traceContoursStreaming(reader.getImageWidth(), reader.getImageHeight(),
+                                              [&reader](Bitmap &rows, int y, int count) {
+                                                  reader.readRows(rows, y, count);
+                                              }, settings.allContours, settings.holes, settings.stripeHeight);
+    });
+}
+
+MidCrackStatus MidCrackEncoder::compress(const MidCrackCode &midCrackCode, std::vector<unsigned char> &compressed) {
+    compressed.clear();
+    return runCall([&] {
+        if (options.legacyFormat) {
+            compressLegacy(midCrackCode, compressed);
+            return;
+        }
+//        blocks compressed in parallel while they are written
+        VectorOutputBuffer buffer(compressed);
+        std::ostream output(&buffer);
+        BlockContainerWriter writer(output, options.compression, pool, midCrackCode.imageWidth,
+                                    midCrackCode.imageHeight);
+        for (const auto &chain : midCrackCode.chains) {
+            writer.startChain(chain.startX, chain.startY, chain.startDirection);
+            writer.append(chain.code);
+        }
+        writer.finish();
+    });
+}
+
+MidCrackStatus MidCrackEncoder::compress(const Bitmap &bitmap, std::vector<unsigned char> &compressed) {
+    compressed.clear();
+    return runCall([&] {
+        if (options.legacyFormat) {
+            MidCrackCode midCrackCode;
+            const MidCrackStatus status = trace(bitmap, midCrackCode);
+            if (!status.ok()) throw MidCrackCodeError(status.message, status.code);
+            compressLegacy(midCrackCode, compressed);
+            return;
+        }
+        VectorOutputBuffer buffer(compressed);
+        std::ostream output(&buffer);
+        compressImage(bitmap, output, options.tracing, options.compression, pool);
+    });
+}
+
+MidCrackStatus MidCrackEncoder::compress(std::istream &image, int threshold, std::ostream &compressed) {
+    return runCall([&] {
+        if (options.legacyFormat) {
+            MidCrackCode midCrackCode;
+            const MidCrackStatus status = trace(image, threshold, midCrackCode);
+            if (!status.ok()) throw MidCrackCodeError(status.message, status.code);
+            std::vector<unsigned char> bytes;
+            compressLegacy(midCrackCode, bytes);
+            compressed.write(reinterpret_cast<const char *>(bytes.data()), (std::streamsize) bytes.size());
+            return;
+        }
+        compressImage(image, threshold, compressed, options.tracing, options.compression, pool);
+    });
+}
+
+MidCrackDecoder::MidCrackDecoder(const MidCrackDecoderOptions &options, unsigned numberOfThreads)
+        : options(options), ownPool(std::make_unique<ThreadPool>(numberOfThreads)), pool(*ownPool) {}
+
+MidCrackDecoder::MidCrackDecoder(const MidCrackDecoderOptions &options, ThreadPool &pool)
+        : options(options), pool(pool) {}
+
+MidCrackStatus MidCrackDecoder::decompress(std::span<const unsigned char> compressed, MidCrackCode &midCrackCode) {
+    return runCall([&] { decompressWhole(compressed, midCrackCode, pool, options.dictionary); });
+}
+
+MidCrackStatus MidCrackDecoder::decompress(std::span<const unsigned char> compressed, std::uint64_t firstDigit,
+                                           std::uint64_t numberOfDigits, MidCrackCode &digits) {
+    return runCall([&] {
+        if (isBlockContainer(compressed)) {
+//            only the blocks with the requested digits
+            BlockContainer container;
+            digits = MidCrackCode();
+            if (!readBlockContainer(compressed, container, options.dictionary) ||
+                !decompressBlocks(container, firstDigit, numberOfDigits, digits.chains.emplace_back().code, pool)) {
+                throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+            }
+            return;
+        }
+//        the older formats have a single chain, which is decompressed as a whole
+        decompressWhole(compressed, digits, pool, options.dictionary);
+        const ChainCode &allDigits = digits.chains[0].code;
+        const std::uint64_t first = std::min<std::uint64_t>(allDigits.size(), firstDigit);
+        ChainCode part;
+        part.append(allDigits, first, std::min(numberOfDigits, allDigits.size() - first));
+        digits.chains[0].code = std::move(part);
+    });
+}
+
+MidCrackStatus MidCrackDecoder::draw(MidCrackCode &midCrackCode, Bitmap &bitmap) {
+    return runCall([&] { bitmap = reconstructBitmap(midCrackCode, options.filled); });
+}
+
+MidCrackStatus MidCrackDecoder::decompressToBitmap(std::span<const unsigned char> compressed, Bitmap &bitmap) {
+    return runCall([&] { bitmap = ::decompressToBitmap(compressed, options.filled, pool, options.dictionary); });
+}
+
+MidCrackStatus MidCrackDecoder::measureShapes(std::span<const unsigned char> compressed,
+                                              std::vector<ShapeMetrics> &metrics) {
+    return runCall([&] { metrics = measureCompressedShapes(compressed, pool, options.dictionary); });
+}
+
+MidCrackStatus measureShapes(const MidCrackCode &midCrackCode, std::vector<ShapeMetrics> &metrics) {
+    return runCall([&] { metrics = ::measureShapes(midCrackCode); });
+}
+
+MidCrackStatus readBmpBytes(std::span<const unsigned char> bytes, int threshold, Bitmap &bitmap) {
+    return runCall([&] { bitmap = Image(bytes, threshold).releaseBitmap(); });
+}
+
+MidCrackStatus writeBmpBytes(const Bitmap &bitmap, std::vector<unsigned char> &bytes, ImageFormat format) {
+    bytes.clear();
+    return runCall([&] {
+//        the image owns its bitmap, so it gets a copy
+        Bitmap copy(bitmap.getWidth(), bitmap.getHeight());
+        for (int y = 0; y < bitmap.getHeight(); ++y) {
+            std::copy_n(bitmap.getRow(y), bitmap.getWordsPerRow(), copy.getRow(y));
+        }
+        Image image;
+        image.setBitmap(std::move(copy));
+        VectorOutputBuffer buffer(bytes);
+        std::ostream output(&buffer);
+        image.writeImage(output, format);
+    });
+}
+
+MidCrackStatus readLzwDictionaryBytes(std::span<const unsigned char> bytes,
+                                      std::shared_ptr<const LzwDictionary> &dictionary) {
+    return runCall([&] { dictionary = std::make_shared<const LzwDictionary>(parseLzwDictionary(bytes)); });
+}
+
+MidCrackStatus writeLzwDictionaryBytes(const LzwDictionary &dictionary, std::vector<unsigned char> &bytes) {
+    bytes.clear();
+    return runCall([&] { writeLzwDictionary(dictionary, bytes); });
+}
+
+MidCrackStatus readMidCrackCodeBytes(std::span<const unsigned char> bytes, MidCrackCode &midCrackCode) {
+    return runCall([&] {
+        midCrackCode = parseMidCrackCode(std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size()));
+    });
+}
+
+MidCrackStatus writeMidCrackCodeBytes(const MidCrackCode &midCrackCode, bool binary,
+                                      std::vector<unsigned char> &bytes) {
+    bytes.clear();
+    return runCall([&] {
+        VectorOutputBuffer buffer(bytes);
+        std::ostream output(&buffer);
+        writeMidCrackCode(output, midCrackCode, binary);
+    });
+}
@@ -0,0 +1,147 @@
+#ifndef MID_CRACK_CODE_MIDCRACK_H
+#define MID_CRACK_CODE_MIDCRACK_H
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+#include "Bitmap.h"
+#include "Image.h"
+#include "MidCrackChain.h"
+#include "Pipeline.h"
+#include "ShapeMetrics.h"
+#include "ThreadPool.h"
+
+// Library interface of mid-crack codes that works on buffers in memory and on streams of the caller: nothing is read
+// from or written to files and errors are returned instead of thrown or printed. The command line program is a
+// wrapper that reads and writes the files around these calls (Files.h). When a call fails, its outputs are left in an
+// unspecified state. The counters of --stats (Stats.h) are global, so encoders and decoders running at the same time
+// add to the same statistics.
+
+/// Outcome of a call of the library.
+struct MidCrackStatus {
+    int code{}; // 0 on success, otherwise the exit code of the command line program for the error
+    std::string message;
+
+    [[nodiscard]] bool ok() const { return code == 0; }
+};
+
+/// Settings of MidCrackEncoder.
+struct MidCrackEncoderOptions {
+    TracingSettings tracing;
+    CompressionSettings compression;
+//    codes of whole bytes in a single stream that older versions can read; it holds a single chain, so images are
+//    only compressed in it without tracing.allContours
+    bool legacyFormat = false;
+};
+
+/// Traces and compresses mid-crack codes. An encoder keeps its thread pool, so it can be reused for many images; it
+/// can be used by one thread at a time.
+class MidCrackEncoder {
+private:
+    MidCrackEncoderOptions options;
+    std::unique_ptr<ThreadPool> ownPool; // unless the pool is shared
+    ThreadPool &pool;
+
+public:
+    /// \param numberOfThreads Threads of the pool of the encoder; 0 uses one thread per hardware thread.
+    explicit MidCrackEncoder(const MidCrackEncoderOptions &options = {}, unsigned numberOfThreads = 0);
+
+    /// Encoder that runs on a pool shared with other work.
+    MidCrackEncoder(const MidCrackEncoderOptions &options, ThreadPool &pool);
+
+    /// Trace the contours of an image (1 is black) with the tracing settings.
+    MidCrackStatus trace(const Bitmap &bitmap, MidCrackCode &midCrackCode);
+
+    /// Read a .bmp or .pbm image from a stream that can seek and trace its contours. With the stream engine, only a
+    /// few rows of the image are in memory at a time.
+    /// \param threshold Pixels with luminance below the threshold are black (otsuThreshold computes it from the image).
+    MidCrackStatus trace(std::istream &image, int threshold, MidCrackCode &midCrackCode);
+
+    /// Compress a mid-crack code with the compression settings.
+    /// \param compressed The compressed mid-crack code replaces its content.
+    MidCrackStatus compress(const MidCrackCode &midCrackCode, std::vector<unsigned char> &compressed);
+
+    /// Trace the contours of an image and compress them without an intermediate mid-crack code.
+    /// \param compressed The compressed mid-crack code replaces its content.
+    MidCrackStatus compress(const Bitmap &bitmap, std::vector<unsigned char> &compressed);
+
+    /// Read an image like trace and compress its contours into a stream. With the stream engine, the blocks are
+    /// written as they are compressed, so neither the image nor the mid-crack code is in memory as a whole.
+    MidCrackStatus compress(std::istream &image, int threshold, std::ostream &compressed);
+};
+
+/// Settings of MidCrackDecoder.
+struct MidCrackDecoderOptions {
+    bool filled = false; // fill the shapes of images instead of drawing only their edges
+//    dictionary of the codes that were compressed with compression.dictionary of the encoder
+    std::shared_ptr<const LzwDictionary> dictionary;
+};
+
+/// Decompresses mid-crack codes and draws their images. Like the encoder, it keeps its thread pool between calls.
+class MidCrackDecoder {
+private:
+    MidCrackDecoderOptions options;
+    std::unique_ptr<ThreadPool> ownPool;
+    ThreadPool &pool;
+
+public:
+    explicit MidCrackDecoder(const MidCrackDecoderOptions &options = {}, unsigned numberOfThreads = 0);
+
+    MidCrackDecoder(const MidCrackDecoderOptions &options, ThreadPool &pool);
+
+    /// Decompress a compressed mid-crack code in any of the formats.
+    MidCrackStatus decompress(std::span<const unsigned char> compressed, MidCrackCode &midCrackCode);
+
+    /// Decompress only the digits [firstDigit, firstDigit + numberOfDigits) of all the chains one after the other;
+    /// of a block container, only the blocks with them are decompressed.
+    /// \param digits Gets a single chain with the digits, without an image size.
+    MidCrackStatus decompress(std::span<const unsigned char> compressed, std::uint64_t firstDigit,
+                              std::uint64_t numberOfDigits, MidCrackCode &digits);
+
+    /// Draw the image of a mid-crack code. A code without an image size gets the bounding box of its chain as its size.
+    MidCrackStatus draw(MidCrackCode &midCrackCode, Bitmap &bitmap);
+
+    /// Decompress a compressed mid-crack code and draw its image without an intermediate mid-crack code.
+    MidCrackStatus decompressToBitmap(std::span<const unsigned char> compressed, Bitmap &bitmap);
+
+    /// Measure the shapes of a compressed mid-crack code as its blocks are decompressed, without the whole code or
+    /// its image in memory.
+    /// \param metrics The metrics of every chain replace its content.
+    MidCrackStatus measureShapes(std::span<const unsigned char> compressed, std::vector<ShapeMetrics> &metrics);
+};
+
+/// Measure the shapes of the chains of a mid-crack code without drawing them.
+/// \param metrics The metrics of every chain replace its content.
+MidCrackStatus measureShapes(const MidCrackCode &midCrackCode, std::vector<ShapeMetrics> &metrics);
+
+/// Binarize a .bmp image with 24 bits per pixel, or 1 or 8 bits per pixel with a palette, or read a binary .pbm image.
+/// \param threshold Pixels with luminance below the threshold are black (otsuThreshold computes it from the image).
+MidCrackStatus readBmpBytes(std::span<const unsigned char> bytes, int threshold, Bitmap &bitmap);
+
+/// Write an image as a .bmp image or a binary .pbm image.
+/// \param bytes The image replaces its content.
+MidCrackStatus writeBmpBytes(const Bitmap &bitmap, std::vector<unsigned char> &bytes,
+                             ImageFormat format = ImageFormat::bmp24);
+
+/// Read an LZW dictionary file, which is trained with LzwDictionaryTrainer from chain codes like the ones that are
+/// compressed with it.
+MidCrackStatus readLzwDictionaryBytes(std::span<const unsigned char> bytes,
+                                      std::shared_ptr<const LzwDictionary> &dictionary);
+
+/// Write an LZW dictionary file.
+/// \param bytes The file replaces its content.
+MidCrackStatus writeLzwDictionaryBytes(const LzwDictionary &dictionary, std::vector<unsigned char> &bytes);
+
+/// Read a mid-crack code in the text or .mcc format.
+MidCrackStatus readMidCrackCodeBytes(std::span<const unsigned char> bytes, MidCrackCode &midCrackCode);
+
+/// Write a mid-crack code in the .mcc format (binary) or in the text format.
+/// \param bytes The mid-crack code replaces its content.
+MidCrackStatus writeMidCrackCodeBytes(const MidCrackCode &midCrackCode, bool binary, std::vector<unsigned char> &bytes);
+
+
+#endif //MID_CRACK_CODE_MIDCRACK_H
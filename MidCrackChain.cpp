@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <sstream>
+#include "Error.h"
+#include "MidCrackChain.h"
+#include "Stats.h"
+
+namespace {
+    const char binaryMagic[3] = {'M', 'C', 'C'};
+    const char binaryVersion = 1;
+
+    void writeNumber(std::string &bytes, std::uint64_t value, int size) {
+        for (int byte = 0; byte < size; ++byte) bytes.push_back((char) (value >> (8 * byte)));
+    }
+
+    std::uint64_t readNumber(std::string_view bytes, std::size_t &position, int size) {
+        std::uint64_t value = 0;
+        for (int byte = 0; byte < size; ++byte) {
+            value |= std::uint64_t((unsigned char) bytes[position++]) << (8 * byte);
+        }
+        return value;
+    }
+
+    /// \return False if the content is not a valid .mcc file.
+    bool readBinaryMidCrackCode(std::string_view content, MidCrackCode &midCrackCode) {
+        const std::size_t headerSize = 16, chainHeaderSize = 17;
+        if (content.size() < headerSize || content[3] != binaryVersion) return false;
+        std::size_t position = 4;
+        midCrackCode.imageWidth = (int) readNumber(content, position, 4);
+        midCrackCode.imageHeight = (int) readNumber(content, position, 4);
+        const std::uint64_t numberOfChains = readNumber(content, position, 4);
+        if ((content.size() - headerSize) / chainHeaderSize < numberOfChains) return false;
+
+        std::vector<std::uint64_t> lengths;
+        for (std::uint64_t i = 0; i < numberOfChains; ++i) {
+            MidCrackChain &chain = midCrackCode.chains.emplace_back();
+            chain.startX = (int) (std::uint32_t) readNumber(content, position, 4);
+            chain.startY = (int) (std::uint32_t) readNumber(content, position, 4);
+            chain.startDirection = (int) readNumber(content, position, 1);
+            lengths.push_back(readNumber(content, position, 8));
+            if (chain.startDirection % 2 != 0 || chain.startDirection > 6) return false;
+        }
+        for (std::size_t i = 0; i < numberOfChains; ++i) {
+            const std::uint64_t length = lengths[i];
+            if (length > (content.size() - position) * 8 / ChainCode::bitsPerDigit) return false;
+            const std::size_t bytes = (length * ChainCode::bitsPerDigit + 7) / 8;
+            std::vector<ChainCode::Word> words((bytes + 7) / 8);
+            for (std::size_t byte = 0; byte < bytes; ++byte) {
+                words[byte / 8] |= ChainCode::Word((unsigned char) content[position++]) << (8 * (byte % 8));
+            }
+            midCrackCode.chains[i].code.assign(std::move(words), length);
+        }
+        return position == content.size();
+    }
+
+    std::string getBinaryMidCrackCode(const MidCrackCode &midCrackCode) {
+        std::string bytes(binaryMagic, 3);
+        bytes.push_back(binaryVersion);
+        writeNumber(bytes, (std::uint32_t) midCrackCode.imageWidth, 4);
+        writeNumber(bytes, (std::uint32_t) midCrackCode.imageHeight, 4);
+        writeNumber(bytes, midCrackCode.chains.size(), 4);
+        for (const auto &chain : midCrackCode.chains) {
+            writeNumber(bytes, (std::uint32_t) chain.startX, 4);
+            writeNumber(bytes, (std::uint32_t) chain.startY, 4);
+            writeNumber(bytes, chain.startDirection, 1);
+            writeNumber(bytes, chain.code.size(), 8);
+        }
+        for (const auto &chain : midCrackCode.chains) {
+            const std::size_t numberOfBytes = (chain.code.size() * ChainCode::bitsPerDigit + 7) / 8;
+            const auto &words = chain.code.getWords();
+            for (std::size_t byte = 0; byte < numberOfBytes; ++byte) {
+                bytes.push_back((char) (words[byte / 8] >> (8 * (byte % 8))));
+            }
+        }
+        return bytes;
+    }
+}
+
+std::uint64_t countDigits(const MidCrackCode &midCrackCode) {
+    std::uint64_t digits = 0;
+    for (const auto &chain : midCrackCode.chains) digits += chain.code.size();
+    return digits;
+}
+
+MidCrackCode parseMidCrackCode(std::string_view content) {
+    StageTimer timer(Stage::parseCode);
+    addStageBytes(Stage::parseCode, content.size(), 0);
+    MidCrackCode midCrackCode;
+    if (content.size() >= 3 && std::equal(binaryMagic, binaryMagic + 3, content.begin())) { // .mcc format
+        if (!readBinaryMidCrackCode(content, midCrackCode)) {
+            throw MidCrackCodeError("The file is not a mid-crack code.");
+        }
+        addStageSymbols(Stage::parseCode, countDigits(midCrackCode));
+        return midCrackCode;
+    }
+
+    const std::size_t firstLineEnd = content.find('\n');
+    if (content.substr(0, firstLineEnd).find(' ') == std::string::npos) { // just the digits of a single chain
+        if (!ChainCode::isText(content)) {
+            throw MidCrackCodeError("Wrong digit.");
+        }
+        midCrackCode.chains.push_back({0, 0, 2, ChainCode(content)});
+        addStageSymbols(Stage::parseCode, countDigits(midCrackCode));
+        return midCrackCode;
+    }
+
+    std::istringstream input{std::string(content)};
+    std::size_t numberOfChains = 0;
+    input >> midCrackCode.imageWidth >> midCrackCode.imageHeight >> numberOfChains;
+    midCrackCode.chains.resize(numberOfChains);
+    std::string digits;
+    for (auto &chain : midCrackCode.chains) {
+        input >> chain.startX >> chain.startY >> chain.startDirection >> digits;
+        if (!ChainCode::isText(digits)) {
+            throw MidCrackCodeError("Wrong digit.");
+        }
+        if (input && (chain.startDirection < 0 || chain.startDirection > 6 || chain.startDirection % 2 != 0)) {
+            throw MidCrackCodeError("Wrong start direction.");
+        }
+        chain.code = ChainCode(digits);
+    }
+    if (!input || midCrackCode.imageWidth <= 0 || midCrackCode.imageHeight <= 0) {
+        throw MidCrackCodeError("The file is not a mid-crack code.");
+    }
+    addStageSymbols(Stage::parseCode, countDigits(midCrackCode));
+    return midCrackCode;
+}
+
+void writeMidCrackCode(std::ostream &outputFile, const MidCrackCode &midCrackCode, bool binary) {
+    if (binary) {
+        outputFile << getBinaryMidCrackCode(midCrackCode);
+    } else if (midCrackCode.imageWidth == 0 && midCrackCode.chains.size() == 1) { // just the digits of a single chain
+        outputFile << midCrackCode.chains[0].code.toString();
+    } else {
+        outputFile << midCrackCode.imageWidth << ' ' << midCrackCode.imageHeight << ' ' << midCrackCode.chains.size()
+                   << '\n';
+        for (const auto &chain : midCrackCode.chains) {
+            outputFile << chain.startX << ' ' << chain.startY << ' ' << chain.startDirection << ' '
+                       << chain.code.toString() << '\n';
+        }
+    }
+}
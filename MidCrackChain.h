@@ -0,0 +1,48 @@
+#ifndef MID_CRACK_CODE_MIDCRACKCHAIN_H
+#define MID_CRACK_CODE_MIDCRACKCHAIN_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ChainCode.h"
+
+/// Mid-crack chain code of one contour.
+struct MidCrackChain {
+//    pixel whose edge the chain starts on
+    int startX{};
+    int startY{};
+//    edge of the starting pixel the chain starts on: 2 = top (outer contours); 6 = bottom (holes)
+    int startDirection = 2;
+//    digits of the chain code
+    ChainCode code;
+};
+
+/// Mid-crack chain codes of all the contours of an image.
+/// In the text format, a file with a single chain and no image size (imageWidth is 0) is stored as just the digits of
+/// the chain; the image is then the bounding box of the chain and the chain starts on the top edge of the top-left
+/// pixel. Otherwise the file starts with a line "imageWidth imageHeight numberOfChains" followed by a line
+/// "startX startY startDirection code" for each chain.
+/// The binary .mcc format starts with 'MCC', the version (1), imageWidth, imageHeight and numberOfChains (uint32),
+/// followed by startX, startY (int32), startDirection (uint8) and the number of digits (uint64) of each chain and then
+/// the digits of each chain packed into 3 bits, least significant bit first, padded to whole bytes. All numbers are
+/// little-endian.
+struct MidCrackCode {
+    int imageWidth{};
+    int imageHeight{};
+    std::vector<MidCrackChain> chains;
+};
+
+/// \return Number of digits of all the chains.
+std::uint64_t countDigits(const MidCrackCode &midCrackCode);
+
+/// Parse the content of a mid-crack code file in the text or .mcc format.
+/// \throw MidCrackCodeError If it is not a mid-crack code.
+MidCrackCode parseMidCrackCode(std::string_view content);
+
+/// Write a mid-crack code to a stream in the .mcc format (binary) or in the text format.
+void writeMidCrackCode(std::ostream &output, const MidCrackCode &midCrackCode, bool binary);
+
+
+#endif //MID_CRACK_CODE_MIDCRACKCHAIN_H
@@ -0,0 +1,141 @@
+#include "ContourTracer.h"
+#include "Error.h"
+#include "Image.h"
+#include "Pipeline.h"
+#include "Reconstruction.h"
+#include "Stats.h"
+
+namespace {
+//    write the chains of a traced mid-crack code into a block container
+    void writeTracedCode(MidCrackCode &midCrackCode, std::ostream &output, const CompressionSettings &settings,
+                         ThreadPool &pool) {
+        if (midCrackCode.chains.empty()) midCrackCode.chains.emplace_back(); // no black pixels
+        BlockContainerWriter writer(output, settings, pool, midCrackCode.imageWidth, midCrackCode.imageHeight);
+        for (const auto &chain : midCrackCode.chains) {
+            writer.startChain(chain.startX, chain.startY, chain.startDirection);
+            writer.append(chain.code);
+        }
+        writer.finish();
+    }
+
+//    trace the contours of an image whose rows are read from the top with the stream engine
+    void compressImageRows(int width, int height, const RowReader &readRows, std::ostream &output,
+                           const TracingSettings &tracingSettings, const CompressionSettings &compressionSettings,
+                           ThreadPool &pool) {
+        if (!tracingSettings.allContours) {
+//            the first object in its bounding box, which is only known once it is traced
+            MidCrackCode midCrackCode = traceContoursStreaming(width, height, readRows, false, tracingSettings.holes,
+                                                               tracingSettings.stripeHeight);
+            writeTracedCode(midCrackCode, output, compressionSettings, pool);
+            return;
+        }
+//        the chains go into the writer as they are closed, while the blocks before them are compressed
+        BlockContainerWriter writer(output, compressionSettings, pool, width, height);
+        traceContoursStreaming(width, height, readRows, true, tracingSettings.holes, [&](MidCrackChain &&chain) {
+            writer.startChain(chain.startX, chain.startY, chain.startDirection);
+            writer.append(chain.code);
+        }, tracingSettings.stripeHeight);
+        writer.finish();
+    }
+}
+
+void compressImage(const Bitmap &bitmap, std::ostream &output, const TracingSettings &tracingSettings,
+                   const CompressionSettings &compressionSettings, ThreadPool &pool) {
+
+    if (tracingSettings.engine == TracingEngine::tiled) {
+//        the stripes are traced in parallel, so the whole code is known before it is compressed
+        MidCrackCode midCrackCode = traceContoursTiled(bitmap, tracingSettings.allContours, tracingSettings.holes, pool,
+                                                       tracingSettings.stripeHeight);
+        writeTracedCode(midCrackCode, output, compressionSettings, pool);
+    } else if (tracingSettings.engine == TracingEngine::stream) {
+        compressImageRows(bitmap.getWidth(), bitmap.getHeight(), getRowReader(bitmap), output, tracingSettings,
+                          compressionSettings, pool);
+    } else if (tracingSettings.allContours) {
+//        trace the contours one after the other into the writer
+        BlockContainerWriter writer(output, compressionSettings, pool, bitmap.getWidth(), bitmap.getHeight());
+        for (const auto &chain : findContourStarts(bitmap, tracingSettings.holes)) {
+            writer.startChain(chain.startX, chain.startY, chain.startDirection);
+            traceContour(bitmap, chain.startX, chain.startY, chain.startDirection, writer);
+        }
+        writer.finish();
+        addStageSymbols(Stage::trace, writer.getNumberOfSymbols());
+    } else {
+//        the first object, in its bounding box that is only known once it is traced
+        BlockContainerWriter writer(output, compressionSettings, pool, 0, 0);
+        writer.startChain(0, 0, 2);
+        const MidCrackCode layout = traceFirstContour(bitmap, writer);
+        writer.setImageOfChain(layout.imageWidth, layout.imageHeight, layout.chains[0].startX, layout.chains[0].startY);
+        writer.finish();
+        addStageSymbols(Stage::trace, writer.getNumberOfSymbols());
+    }
+}
+
+void compressImage(std::istream &image, int threshold, std::ostream &output, const TracingSettings &tracingSettings,
+                   const CompressionSettings &compressionSettings, ThreadPool &pool) {
+    if (tracingSettings.engine != TracingEngine::stream) {
+        compressImage(Image(image, threshold).getBitmap(), output, tracingSettings, compressionSettings, pool);
+        return;
+    }
+    ImageReader reader(image, threshold);
+    compressImageRows(reader.getImageWidth(), reader.getImageHeight(), [&reader](Bitmap &rows, int y, int count) {
+        reader.readRows(rows, y, count);
+    }, output, tracingSettings, compressionSettings, pool);
+}
+
+Bitmap decompressToBitmap(std::span<const unsigned char> bytes, bool filled, ThreadPool &pool,
+                          const std::shared_ptr<const LzwDictionary> &dictionary) {
+    BlockContainer container;
+    if (!readBlockContainer(bytes, container, dictionary)) {
+//        the older formats are decompressed as a whole
+        MidCrackCode midCrackCode;
+        if (!decompressMidCrackCode(bytes, midCrackCode, pool)) {
+            throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+        }
+        return reconstructBitmap(midCrackCode, filled);
+    }
+
+    MidCrackCode &midCrackCode = container.layout;
+    if (midCrackCode.imageWidth == 0 && (midCrackCode.chains.empty() || container.chainLengths[0] == 0)) {
+        throw MidCrackCodeError("The mid-crack code is empty.");
+    }
+    bool valid = true;
+    if (midCrackCode.imageWidth == 0) {
+//        a single chain, the image is its bounding box, which is found by decompressing the blocks once more
+        ChainBounds bounds;
+        valid = decompressBlocksInOrder(container, pool, [&](const unsigned char *digits, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) bounds.push_back(digits[i]);
+        });
+        bounds.setImageOf(midCrackCode);
+    }
+
+//    plot the digits of each block, moving to the next chain when all the digits of a chain are plotted
+    Bitmap bitmap(midCrackCode.imageWidth, midCrackCode.imageHeight);
+    if (midCrackCode.chains.empty()) return bitmap; // an image without contours is white
+    ChainPlotter plotter(bitmap, filled);
+    std::size_t chain = 0;
+    std::uint64_t remainingDigits = container.chainLengths[0];
+    plotter.startChain(midCrackCode.chains[0]);
+    valid = valid && decompressBlocksInOrder(container, pool, [&](const unsigned char *digits, std::size_t count) {
+        StageTimer timer(Stage::reconstruct);
+        addStageSymbols(Stage::reconstruct, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            while (remainingDigits == 0) {
+                remainingDigits = container.chainLengths[++chain];
+                plotter.startChain(midCrackCode.chains[chain]);
+            }
+            plotter.push_back(digits[i]);
+            --remainingDigits;
+        }
+    });
+    if (!valid) {
+        throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+    }
+//    chains without digits after the last digit
+    {
+        StageTimer timer(Stage::reconstruct);
+        while (++chain < midCrackCode.chains.size()) plotter.startChain(midCrackCode.chains[chain]);
+        plotter.finish();
+    }
+
+    return bitmap;
+}
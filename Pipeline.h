@@ -0,0 +1,51 @@
+#ifndef MID_CRACK_CODE_PIPELINE_H
+#define MID_CRACK_CODE_PIPELINE_H
+
+#include <istream>
+#include <ostream>
+#include <span>
+#include "BlockContainer.h"
+#include "Bitmap.h"
+
+/// How the contours of an image are traced; all of them give the same mid-crack code.
+enum class TracingEngine {
+    trace, // trace whole contours one after the other
+    tiled, // trace stripes of the image in parallel and join the fragments of the contours
+    stream // read the rows of the image once from the top and join the fragments of the contours in each stripe
+};
+
+/// Settings of tracing the contours of an image.
+struct TracingSettings {
+    bool allContours = false; // trace the contours of all the objects, not only the first one
+    bool holes = false; // also trace the contours of holes
+    TracingEngine engine = TracingEngine::trace;
+    int stripeHeight = 0;
+};
+
+/// Trace the contours of an image and compress their mid-crack code into a block container without an intermediate
+/// mid-crack code. With the trace engine the digits go straight from the tracer into the blocks, which are compressed
+/// on the thread pool while the next contours are traced.
+/// \param output The block container is written to output as the blocks are compressed.
+void compressImage(const Bitmap &bitmap, std::ostream &output, const TracingSettings &tracingSettings,
+                   const CompressionSettings &compressionSettings, ThreadPool &pool);
+
+/// Read an image, trace its contours and compress their mid-crack code like compressImage. With the stream engine the
+/// rows of the image are traced as they are read and the blocks are written as they are compressed, so neither the
+/// image nor its code is in memory as a whole; the other engines read the whole image first.
+/// \param image .bmp or .pbm image in a stream that can seek.
+/// \param threshold Pixels with luminance below the threshold are black (otsuThreshold computes it from the image).
+/// \throw MidCrackCodeError If the image cannot be read.
+void compressImage(std::istream &image, int threshold, std::ostream &output, const TracingSettings &tracingSettings,
+                   const CompressionSettings &compressionSettings, ThreadPool &pool);
+
+/// Decompress a compressed mid-crack code and create the image of its edges without an intermediate mid-crack code.
+/// The digits of a block container are plotted block by block while the next blocks are decompressed on the thread
+/// pool.
+/// \param filled Fill the shapes instead of setting only their edges.
+/// \param dictionary The LZW dictionary of a block container of version 3.
+/// \throw MidCrackCodeError If the compressed mid-crack code is corrupted or needs another LZW dictionary.
+Bitmap decompressToBitmap(std::span<const unsigned char> bytes, bool filled, ThreadPool &pool,
+                          const std::shared_ptr<const LzwDictionary> &dictionary = nullptr);
+
+
+#endif //MID_CRACK_CODE_PIPELINE_H
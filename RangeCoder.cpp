@@ -0,0 +1,171 @@
+#include "RangeCoder.h"
+#include <algorithm>
+
+namespace {
+    using Probability = std::uint16_t;
+//    probabilities of a zero bit in 1/2048
+    const int probabilityBits = 11;
+    const Probability probabilityOne = 1 << probabilityBits;
+//    a probability moves 1/32 of the way towards the coded bit
+    const int adaptationShift = 5;
+//    the range is shifted by a byte whenever it falls below this
+    const std::uint32_t topValue = 1u << 24;
+
+    /// Adaptive probabilities of the bits of the next turn.
+    /// Every context has a binary tree of 7 probabilities (index 0 is unused): the first bit of a turn is coded with
+    /// tree[1], the second with tree[2 + first bit] and the third with tree[4 + first two bits].
+    class TurnModel {
+    private:
+        std::uint32_t historyMask;
+//        last turns, 3 bits each, the last one in the lowest bits
+        std::uint32_t history = 0;
+        int previousDigit = 0;
+        std::vector<Probability> probabilities;
+
+    public:
+        explicit TurnModel(int contextOrder)
+                : historyMask((1u << (3 * contextOrder)) - 1),
+                  probabilities(std::size_t(16) << (3 * contextOrder), probabilityOne / 2) {}
+
+        Probability *getTree() { return &probabilities[((history << 1) | (previousDigit & 1)) << 3]; }
+
+        [[nodiscard]] int toTurn(int digit) const { return (digit - previousDigit) & 7; }
+
+        [[nodiscard]] int toDigit(int turn) const { return (previousDigit + turn) & 7; }
+
+        void update(int digit, int turn) {
+            history = ((history << 3) | (std::uint32_t) turn) & historyMask;
+            previousDigit = digit;
+        }
+    };
+
+    /// Binary range encoder with carry propagation: low keeps a 33rd bit for the carry, and a byte that may still
+    /// change by a carry is kept in cache with the number of 0xFF bytes after it.
+    class RangeEncoder {
+    private:
+        std::vector<unsigned char> &bytes;
+        std::uint64_t low = 0;
+        std::uint32_t range = 0xFFFFFFFF;
+        unsigned char cache = 0;
+        std::uint64_t cacheSize = 1;
+
+        void shiftLow() {
+            if ((std::uint32_t) low < 0xFF000000 || (low >> 32) != 0) {
+                const auto carry = (unsigned char) (low >> 32);
+                unsigned char byte = cache;
+                do {
+                    bytes.push_back((unsigned char) (byte + carry));
+                    byte = 0xFF;
+                } while (--cacheSize != 0);
+                cache = (unsigned char) (low >> 24);
+            }
+            ++cacheSize;
+            low = (low & 0x00FFFFFF) << 8;
+        }
+
+    public:
+        explicit RangeEncoder(std::vector<unsigned char> &bytes) : bytes(bytes) {}
+
+        void encode(Probability &probability, int bit) {
+            const std::uint32_t bound = (range >> probabilityBits) * probability;
+            if (bit == 0) {
+                range = bound;
+                probability += (probabilityOne - probability) >> adaptationShift;
+            } else {
+                low += bound;
+                range -= bound;
+                probability -= probability >> adaptationShift;
+            }
+//            a probability is never below 31/2048, so the range needs at most one shift
+            if (range < topValue) {
+                range <<= 8;
+                shiftLow();
+            }
+        }
+
+        void flush() {
+            for (int i = 0; i < 5; ++i) shiftLow();
+        }
+    };
+
+    class RangeDecoder {
+    private:
+        const unsigned char *bytes;
+        std::size_t size;
+        std::size_t position = 0;
+        std::uint32_t range = 0xFFFFFFFF;
+        std::uint32_t code = 0;
+
+//        reading past the end gives zeros, valid() tells if that happened
+        std::uint32_t nextByte() { return position < size ? bytes[position++] : (++position, 0); }
+
+    public:
+        RangeDecoder(const unsigned char *bytes, std::size_t size) : bytes(bytes), size(size) {
+            for (int i = 0; i < 5; ++i) code = (code << 8) | nextByte();
+        }
+
+        int decode(Probability &probability) {
+            const std::uint32_t bound = (range >> probabilityBits) * probability;
+            int bit;
+            if (code < bound) {
+                range = bound;
+                probability += (probabilityOne - probability) >> adaptationShift;
+                bit = 0;
+            } else {
+                code -= bound;
+                range -= bound;
+                probability -= probability >> adaptationShift;
+                bit = 1;
+            }
+            if (range < topValue) {
+                range <<= 8;
+                code = (code << 8) | nextByte();
+            }
+            return bit;
+        }
+
+        [[nodiscard]] bool valid() const { return position <= size; }
+    };
+}
+
+void encodeTurns(const ChainCode &digits, std::size_t first, std::size_t count, int contextOrder,
+                 std::vector<unsigned char> &bytes) {
+    RangeEncoder encoder(bytes);
+    TurnModel model(contextOrder);
+    const std::size_t end = first + count;
+    for (std::size_t i = first; i < end; i += ChainCode::digitsPerWord) {
+        const int wordDigits = (int) std::min<std::size_t>(ChainCode::digitsPerWord, end - i);
+        ChainCode::Word word = digits.getDigits(i, wordDigits);
+        for (int j = 0; j < wordDigits; ++j, word >>= ChainCode::bitsPerDigit) {
+            const int digit = (int) (word & 7);
+            const int turn = model.toTurn(digit);
+            Probability *tree = model.getTree();
+            int node = 1;
+            for (int bit = 2; bit >= 0; --bit) {
+                const int value = (turn >> bit) & 1;
+                encoder.encode(tree[node], value);
+                node = 2 * node + value;
+            }
+            model.update(digit, turn);
+        }
+    }
+    encoder.flush();
+}
+
+bool decodeTurns(const unsigned char *bytes, std::size_t size, int contextOrder, unsigned char *digits,
+                 std::size_t count) {
+    RangeDecoder decoder(bytes, size);
+    TurnModel model(contextOrder);
+    for (std::size_t i = 0; i < count; ++i) {
+        Probability *tree = model.getTree();
+        int node = 1;
+        node = 2 * node + decoder.decode(tree[node]);
+        node = 2 * node + decoder.decode(tree[node]);
+        node = 2 * node + decoder.decode(tree[node]);
+        const int turn = node - 8;
+        const int digit = model.toDigit(turn);
+        digits[i] = (unsigned char) digit;
+        model.update(digit, turn);
+    }
+    return decoder.valid();
+}
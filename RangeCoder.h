@@ -0,0 +1,28 @@
+#ifndef MID_CRACK_CODE_RANGECODER_H
+#define MID_CRACK_CODE_RANGECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ChainCode.h"
+
+/// Limits of the number of previous turns that select the probabilities of the next turn.
+const int turnsMaxContextOrder = 4;
+const int turnsDefaultContextOrder = 3;
+
+/// Compress the digits [first, first + count) of a chain code as relative turns with an adaptive range coder.
+/// Each digit is turned into (digit - previous digit) mod 8, which is mostly 0 or a small turn along a contour. The 3
+/// bits of a turn are coded one by one from the most significant, each with an adaptive probability selected by the
+/// bits already coded, the last contextOrder turns and whether the previous digit is diagonal. The probabilities are
+/// 11-bit numbers updated with a shift, so coding a digit is a few table lookups, multiplications and no divisions.
+/// \param bytes The coded bytes are appended to bytes.
+void encodeTurns(const ChainCode &digits, std::size_t first, std::size_t count, int contextOrder,
+                 std::vector<unsigned char> &bytes);
+
+/// Decompress exactly count digits coded by encodeTurns, one digit per byte.
+/// \return False if the coded bytes end too early.
+bool decodeTurns(const unsigned char *bytes, std::size_t size, int contextOrder, unsigned char *digits,
+                 std::size_t count);
+
+
+#endif //MID_CRACK_CODE_RANGECODER_H
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include "ContourTracer.h"
+#include "Error.h"
+#include "Reconstruction.h"
+#include "Stats.h"
+
+namespace {
+//    move of the midpoint of the edge along each digit in half pixels: right, up and right, up, up and left, ...
+    constexpr int xStepOfDigit[8] = {2, 1, 0, -1, -2, -1, 0, 1};
+    constexpr int yStepOfDigit[8] = {0, -1, -2, -1, 0, 1, 2, 1};
+}
+
+void ChainBounds::push_back(int digit) {
+    xCurrent += xStepOfDigit[digit];
+    yCurrent += yStepOfDigit[digit];
+
+    // update bounds
+    if (xCurrent < xBoundsLeft) xBoundsLeft = xCurrent;
+    if (xCurrent > xBoundsRight) xBoundsRight = xCurrent;
+    if (yCurrent > yBoundsDown) yBoundsDown = yCurrent;
+    if (yCurrent < 0) aboveStart = true;
+}
+
+void ChainBounds::setImageOf(MidCrackCode &midCrackCode) const {
+    if (aboveStart) throw MidCrackCodeError("Wrong bounds.");
+
+//    set starting point; the leftmost edge is at 2x - 1 half pixels for its pixel x <= 0 and the rightmost edge at
+//    2x + 1, so divisions that round towards zero give their pixels
+    midCrackCode.chains[0].startX = -xBoundsLeft / 2;
+    midCrackCode.chains[0].startY = 0;
+
+    midCrackCode.imageWidth = 1 + xBoundsRight / 2 - xBoundsLeft / 2;
+    midCrackCode.imageHeight = yBoundsDown / 2;
+}
+
+ChainPlotter::ChainPlotter(Bitmap &bitmap, bool filled) : bitmap(bitmap), filled(filled) {
+    if (filled) edgesOfRows.resize(bitmap.getHeight());
+}
+
+void ChainPlotter::setPixel() {
+    if (x < 0 || y < 0 || x >= bitmap.getWidth() || y >= bitmap.getHeight()) {
+        throw MidCrackCodeError("Wrong bounds.");
+    }
+    bitmap.set(x, y);
+    if (filled && direction == 4) edgesOfRows[y].push_back(2 * x);
+    else if (filled && direction == 0) edgesOfRows[y].push_back(2 * x + 1);
+}
+
+void ChainPlotter::startChain(const MidCrackChain &chain) {
+    x = chain.startX;
+    y = chain.startY;
+    direction = chain.startDirection; // top = 2; right = 0; bottom = 6; left = 4;
+    setPixel();
+}
+
+void ChainPlotter::push_back(int digit) {
+    followMidCrackDigit(x, y, direction, digit);
+    setPixel();
+}
+
+void ChainPlotter::finish() {
+    if (!filled) return;
+    for (int row = 0; row < bitmap.getHeight(); ++row) {
+        std::vector<int> &edges = edgesOfRows[row];
+        std::sort(edges.begin(), edges.end());
+//        an edge is passed twice only by the closing digits of a contour that returns to its start early
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+//        nested shapes without the contours of the holes between them have several left edges before a right edge
+        int depth = 0, runStart = 0;
+        for (int edge : edges) {
+            if (edge % 2 == 0) {
+                if (depth++ == 0) runStart = edge / 2;
+            } else if (depth > 0 && --depth == 0) {
+                bitmap.setRun(row, runStart, edge / 2 + 1);
+            }
+        }
+        edges = std::vector<int>();
+    }
+}
+
+Bitmap reconstructBitmap(MidCrackCode &midCrackCode, bool filled) {
+//    without an image size, the image is the bounding box of the digits; with it, an image without contours is white
+    if (midCrackCode.imageWidth == 0 && (midCrackCode.chains.empty() || midCrackCode.chains[0].code.empty())) {
+        throw MidCrackCodeError("The mid-crack code is empty.");
+    }
+    StageTimer timer(Stage::reconstruct);
+    addStageSymbols(Stage::reconstruct, countDigits(midCrackCode));
+
+    if (midCrackCode.imageWidth == 0) { // a single chain, the image is its bounding box
+//        find bounds of image by keeping track of the relative position from the starting pixel
+        ChainBounds bounds;
+        const ChainCode &code = midCrackCode.chains[0].code;
+        for (std::size_t i = 0; i < code.size(); ++i) bounds.push_back(code[i]);
+        bounds.setImageOf(midCrackCode);
+    }
+
+//    initialize image
+    Bitmap bitmap(midCrackCode.imageWidth, midCrackCode.imageHeight);
+
+//    set edges from mid-crack code into bit image
+    ChainPlotter plotter(bitmap, filled);
+    for (const auto &chain : midCrackCode.chains) {
+        plotter.startChain(chain);
+        for (std::size_t i = 0; i < chain.code.size(); ++i) plotter.push_back(chain.code[i]);
+    }
+    plotter.finish();
+    return bitmap;
+}
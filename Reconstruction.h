@@ -0,0 +1,60 @@
+#ifndef MID_CRACK_CODE_RECONSTRUCTION_H
+#define MID_CRACK_CODE_RECONSTRUCTION_H
+
+#include "Bitmap.h"
+#include "ChainCode.h"
+#include "MidCrackChain.h"
+
+/// Finds the bounding box of a single chain that starts on the top edge of a pixel, digit by digit. The image of a
+/// mid-crack code without an image size is this bounding box. Codes written by traceFirstContour have their box in the
+/// header and need no bounds pass.
+class ChainBounds final : public ChainCodeSink {
+private:
+//    positions of the midpoints of the edges in half pixels, relative to the midpoint of the first edge
+    int xBoundsRight = 0, xBoundsLeft = 0, yBoundsDown = 0; // farthest positions
+    int xCurrent = 0, yCurrent = 0;
+//    the chain goes above its first edge, which has to be on the top row of the image
+    bool aboveStart = false;
+
+public:
+    void push_back(int digit) override;
+
+    /// Set the image size and the start of the chain of a mid-crack code without an image size.
+    /// \throw MidCrackCodeError If the chain does not start on the top row of its bounding box.
+    void setImageOf(MidCrackCode &midCrackCode) const;
+};
+
+/// Sets the pixels whose edges a chain passes, digit by digit.
+/// To fill the shapes, it also records on each row the left and right edges the chains pass. A left edge starts a run
+/// of black pixels and a right edge ends it, whichever way the chain goes, so finish() fills the runs of every row
+/// without a flood fill. The holes whose contours are not in the code are filled too.
+class ChainPlotter final : public ChainCodeSink {
+private:
+    Bitmap &bitmap;
+    int x{}, y{}, direction{};
+    bool filled;
+//    edges of the pixels of each row: 2x for the left edge and 2x + 1 for the right edge of pixel x
+    std::vector<std::vector<int>> edgesOfRows;
+
+    void setPixel();
+
+public:
+    ChainPlotter(Bitmap &bitmap, bool filled);
+
+    /// Start the next chain and set its first pixel.
+    void startChain(const MidCrackChain &chain);
+
+    void push_back(int digit) override;
+
+    /// When the shapes are filled, set the pixels between the edges of every row.
+    void finish();
+};
+
+/// Create the image of the edges of the chains of a mid-crack code.
+/// A code without an image size gets the bounding box of its chain as its size.
+/// \param filled Fill the shapes instead of setting only their edges.
+/// \throw MidCrackCodeError If the code is empty or goes outside of the image.
+Bitmap reconstructBitmap(MidCrackCode &midCrackCode, bool filled);
+
+
+#endif //MID_CRACK_CODE_RECONSTRUCTION_H
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <numbers>
+#include "BlockContainer.h"
+#include "ContourTracer.h"
+#include "Error.h"
+#include "Reconstruction.h"
+#include "ShapeMetrics.h"
+#include "Stats.h"
+
+void ShapeMeasurer::startChain(const MidCrackChain &chain) {
+    if (started) finishChain();
+    started = true;
+    x = chain.startX;
+    y = chain.startY;
+    direction = chain.startDirection;
+    metrics.push_back({x, y, direction, 0, 0, 0, x, y, x, y});
+    m10 = m01 = m20 = m11 = m02 = 0;
+}
+
+void ShapeMeasurer::push_back(int digit) {
+    ShapeMetrics &shape = metrics.back();
+    ++shape.numberOfDigits;
+    shape.perimeter += digit % 2 == 0 ? 1 : std::numbers::sqrt2 / 2;
+    followMidCrackDigit(x, y, direction, digit);
+    shape.left = std::min(shape.left, x);
+    shape.top = std::min(shape.top, y);
+    shape.right = std::max(shape.right, x);
+    shape.bottom = std::max(shape.bottom, y);
+
+//    the pixels of the row left of a right edge are added, those left of a left edge are subtracted
+    if (direction != 0 && direction != 4) return;
+    const int edge = direction == 0 ? x + 1 : x; // pixels 0 to edge - 1
+    const int sign = direction == 0 ? 1 : -1;
+    shape.area += sign * edge;
+    const double row = y + 0.5;
+    m10 += sign * (double) edge * edge / 2; // sum of i + 0.5 for i < edge
+    m01 += sign * edge * row;
+    m20 += sign * edge * (4.0 * edge * edge - 1) / 12; // sum of (i + 0.5)^2 for i < edge
+    m11 += sign * (double) edge * edge / 2 * row;
+    m02 += sign * edge * row * row;
+}
+
+void ShapeMeasurer::finishChain() {
+    ShapeMetrics &shape = metrics.back();
+//    the chain of a pixel without neighbours ends on its left edge; the corner back to its top edge is implied
+    if (shape.numberOfDigits == 3 && direction == 4 && shape.startDirection == 2 && x == shape.startX &&
+        y == shape.startY) {
+        shape.perimeter += std::numbers::sqrt2 / 2;
+    }
+    if (shape.area == 0) return;
+    const double area = (double) shape.area;
+    shape.centroidX = m10 / area;
+    shape.centroidY = m01 / area;
+    shape.mu20 = m20 - m10 * shape.centroidX;
+    shape.mu11 = m11 - m10 * shape.centroidY;
+    shape.mu02 = m02 - m01 * shape.centroidY;
+}
+
+void ShapeMeasurer::finish() {
+    if (started) finishChain();
+    started = false;
+}
+
+namespace {
+//    the chain of a code without an image size starts on the top row of its bounding box
+    MidCrackChain placeSingleChain(const ChainBounds &bounds, const MidCrackChain &chain) {
+        MidCrackCode layout;
+        layout.chains.push_back({chain.startX, chain.startY, chain.startDirection, {}});
+        bounds.setImageOf(layout);
+        return std::move(layout.chains[0]);
+    }
+}
+
+std::vector<ShapeMetrics> measureShapes(const MidCrackCode &midCrackCode) {
+    StageTimer timer(Stage::measure);
+    addStageSymbols(Stage::measure, countDigits(midCrackCode));
+    std::vector<ShapeMetrics> metrics;
+    ShapeMeasurer measurer(metrics);
+    for (const auto &chain : midCrackCode.chains) {
+        if (midCrackCode.imageWidth == 0) {
+            ChainBounds bounds;
+            for (std::size_t i = 0; i < chain.code.size(); ++i) bounds.push_back(chain.code[i]);
+            measurer.startChain(placeSingleChain(bounds, chain));
+        } else {
+            measurer.startChain(chain);
+        }
+        for (std::size_t i = 0; i < chain.code.size(); ++i) measurer.push_back(chain.code[i]);
+    }
+    measurer.finish();
+    return metrics;
+}
+
+std::vector<ShapeMetrics> measureCompressedShapes(std::span<const unsigned char> bytes, ThreadPool &pool,
+                                                  const std::shared_ptr<const LzwDictionary> &dictionary) {
+    BlockContainer container;
+    if (!readBlockContainer(bytes, container, dictionary)) {
+//        the older formats are decompressed as a whole
+        MidCrackCode midCrackCode;
+        if (!decompressMidCrackCode(bytes, midCrackCode, pool)) {
+            throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+        }
+        return measureShapes(midCrackCode);
+    }
+
+    const MidCrackCode &layout = container.layout;
+    std::vector<ShapeMetrics> metrics;
+    if (layout.chains.empty()) return metrics;
+    bool valid = true;
+    MidCrackChain firstChain = {layout.chains[0].startX, layout.chains[0].startY, layout.chains[0].startDirection, {}};
+    if (layout.imageWidth == 0) {
+//        a single chain in its bounding box, which is found by decompressing the blocks once more
+        ChainBounds bounds;
+        valid = decompressBlocksInOrder(container, pool, [&](const unsigned char *digits, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) bounds.push_back(digits[i]);
+        });
+        firstChain = placeSingleChain(bounds, firstChain);
+    }
+
+//    measure the digits of each block, moving to the next chain when all the digits of a chain are measured
+    ShapeMeasurer measurer(metrics);
+    std::size_t chain = 0;
+    std::uint64_t remainingDigits = container.chainLengths[0];
+    measurer.startChain(firstChain);
+    valid = valid && decompressBlocksInOrder(container, pool, [&](const unsigned char *digits, std::size_t count) {
+        StageTimer timer(Stage::measure);
+        addStageSymbols(Stage::measure, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            while (remainingDigits == 0) {
+                remainingDigits = container.chainLengths[++chain];
+                measurer.startChain(layout.chains[chain]);
+            }
+            measurer.push_back(digits[i]);
+            --remainingDigits;
+        }
+    });
+    if (!valid) {
+        throw MidCrackCodeError("The compressed mid-crack code is corrupted.");
+    }
+//    chains without digits after the last digit
+    while (++chain < layout.chains.size()) measurer.startChain(layout.chains[chain]);
+    measurer.finish();
+    return metrics;
+}
+
+void writeShapeMetricsJson(std::ostream &output, const std::vector<ShapeMetrics> &metrics) {
+    const std::streamsize precision = output.precision(15); // coordinates of large images in fractions of pixels
+    for (std::size_t i = 0; i < metrics.size(); ++i) {
+        const ShapeMetrics &shape = metrics[i];
+        output << "{\"chain\":" << i << ",\"startX\":" << shape.startX << ",\"startY\":" << shape.startY
+               << ",\"hole\":" << (shape.isHole() ? "true" : "false") << ",\"digits\":" << shape.numberOfDigits
+               << ",\"perimeter\":" << shape.perimeter << ",\"area\":" << shape.area << ",\"left\":" << shape.left
+               << ",\"top\":" << shape.top << ",\"right\":" << shape.right << ",\"bottom\":" << shape.bottom
+               << ",\"centroidX\":" << shape.centroidX << ",\"centroidY\":" << shape.centroidY
+               << ",\"mu20\":" << shape.mu20 << ",\"mu11\":" << shape.mu11 << ",\"mu02\":" << shape.mu02 << "}\n";
+    }
+    output.precision(precision);
+}
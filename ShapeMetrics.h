@@ -0,0 +1,73 @@
+#ifndef MID_CRACK_CODE_SHAPEMETRICS_H
+#define MID_CRACK_CODE_SHAPEMETRICS_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+#include "ChainCode.h"
+#include "LzwDictionary.h"
+#include "MidCrackChain.h"
+#include "ThreadPool.h"
+
+/// Measurements of the shape a chain goes around, found from its digits without drawing it.
+/// The area and the moments count the pixels inside the contour with Green's theorem: every right edge of a pixel the
+/// chain passes adds the pixels of its row up to the edge and every left edge subtracts them. They are negative for
+/// holes, so the sums over all the chains of an image are those of its black pixels. The moments are of the centres of
+/// the pixels, (x + 0.5, y + 0.5).
+struct ShapeMetrics {
+    int startX{}, startY{}, startDirection{};
+    std::uint64_t numberOfDigits{};
+    double perimeter{}; // length of the chain: 1 for a straight digit and sqrt(2) / 2 for a corner
+    std::int64_t area{}; // number of pixels inside the contour
+    int left{}, top{}, right{}, bottom{}; // pixels the chain passes; the right and bottom pixels are inside
+    double centroidX{}, centroidY{}; // 0 if the area is 0
+//    central second moments: the sums of (x - centroidX)^2, (x - centroidX)(y - centroidY) and (y - centroidY)^2
+    double mu20{}, mu11{}, mu02{};
+
+    [[nodiscard]] bool isHole() const { return startDirection == 6; }
+};
+
+/// Measures the chains digit by digit, keeping only a few numbers for the current chain.
+class ShapeMeasurer final : public ChainCodeSink {
+private:
+    std::vector<ShapeMetrics> &metrics;
+    int x{}, y{}, direction{};
+    bool started = false;
+//    raw moments of the pixels: sums of 1, x, y, x^2, xy and y^2
+    double m10{}, m01{}, m20{}, m11{}, m02{};
+
+    void finishChain();
+
+public:
+    /// \param metrics The metrics of every chain are appended to it.
+    explicit ShapeMeasurer(std::vector<ShapeMetrics> &metrics) : metrics(metrics) {}
+
+    /// Finish the current chain and start the next one.
+    void startChain(const MidCrackChain &chain);
+
+    void push_back(int digit) override;
+
+    /// Finish the last chain.
+    void finish();
+};
+
+/// Measure the shapes of all the chains of a mid-crack code. A code without an image size has its chain placed in its
+/// bounding box, like when it is drawn.
+/// \throw MidCrackCodeError If the chain of a code without an image size does not start on its top row.
+std::vector<ShapeMetrics> measureShapes(const MidCrackCode &midCrackCode);
+
+/// Measure the shapes of a compressed mid-crack code. The blocks of a block container are decompressed in order on
+/// the thread pool and measured as they come, so the whole code is never in memory; older formats are decompressed as
+/// a whole.
+/// \param dictionary The LZW dictionary of a block container of version 3.
+/// \throw MidCrackCodeError If the compressed mid-crack code is corrupted or needs another LZW dictionary.
+std::vector<ShapeMetrics> measureCompressedShapes(std::span<const unsigned char> bytes, ThreadPool &pool,
+                                                  const std::shared_ptr<const LzwDictionary> &dictionary = nullptr);
+
+/// Write the metrics of every chain as a JSON object on its own line.
+void writeShapeMetricsJson(std::ostream &output, const std::vector<ShapeMetrics> &metrics);
+
+
+#endif //MID_CRACK_CODE_SHAPEMETRICS_H
@@ -0,0 +1,102 @@
+#include <atomic>
+#include "Stats.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+namespace {
+    const char *const stageNames[numberOfStages] = {"parseHeader", "readFile", "binarize", "findStarts", "trace",
+                                                    "parseCode", "encode", "decode", "reconstruct", "measure",
+                                                    "writeFile"};
+
+    struct StageCounters {
+        std::atomic<std::uint64_t> calls{};
+        std::atomic<std::uint64_t> nanoseconds{};
+        std::atomic<std::uint64_t> bytesIn{};
+        std::atomic<std::uint64_t> bytesOut{};
+        std::atomic<std::uint64_t> symbols{};
+    };
+
+    StageCounters counters[numberOfStages];
+    std::atomic<std::size_t> lzwDictionarySize{};
+    std::atomic<int> lzwCodeWidth{};
+    std::chrono::steady_clock::time_point runStart;
+
+    template<typename Number>
+    void storeMax(std::atomic<Number> &maximum, Number value) {
+        Number current = maximum.load(std::memory_order_relaxed);
+        while (current < value && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    StageCounters &getCounters(Stage stage) {
+        return counters[(int) stage];
+    }
+}
+
+#ifdef MID_CRACK_CODE_STATS
+bool statsDetail::enabled = false;
+
+void statsDetail::addTime(Stage stage, std::chrono::steady_clock::duration time) {
+    StageCounters &stageCounters = getCounters(stage);
+    stageCounters.calls.fetch_add(1, std::memory_order_relaxed);
+    stageCounters.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+                                        std::memory_order_relaxed);
+}
+
+void statsDetail::addBytes(Stage stage, std::uint64_t bytesIn, std::uint64_t bytesOut) {
+    getCounters(stage).bytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+    getCounters(stage).bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+}
+
+void statsDetail::addSymbols(Stage stage, std::uint64_t symbols) {
+    getCounters(stage).symbols.fetch_add(symbols, std::memory_order_relaxed);
+}
+
+void statsDetail::recordLzwDictionary(std::size_t dictionarySize, int codeWidth) {
+    storeMax(lzwDictionarySize, dictionarySize);
+    storeMax(lzwCodeWidth, codeWidth);
+}
+#endif
+
+void enableStats() {
+#ifdef MID_CRACK_CODE_STATS
+    statsDetail::enabled = true;
+#endif
+    runStart = std::chrono::steady_clock::now();
+}
+
+void writeStatsJson(std::ostream &output) {
+    const std::chrono::duration<double> runTime = std::chrono::steady_clock::now() - runStart;
+    output << "{\"stages\":[";
+    bool first = true;
+    for (int stage = 0; stage < numberOfStages; ++stage) {
+        const StageCounters &stageCounters = counters[stage];
+        if (stageCounters.calls == 0) continue;
+        output << (first ? "" : ",") << "{\"stage\":\"" << stageNames[stage] << "\",\"calls\":" << stageCounters.calls
+               << ",\"seconds\":" << (double) stageCounters.nanoseconds / 1e9 << ",\"bytesIn\":"
+               << stageCounters.bytesIn << ",\"bytesOut\":" << stageCounters.bytesOut << ",\"symbols\":"
+               << stageCounters.symbols << "}";
+        first = false;
+    }
+    output << "]";
+    if (lzwCodeWidth != 0) {
+        output << ",\"lzwDictionarySize\":" << lzwDictionarySize << ",\"lzwCodeWidth\":" << lzwCodeWidth;
+    }
+//    the ratio of the packed digits to the compressed bytes, of compressing or else of decompressing
+    const StageCounters &encode = getCounters(Stage::encode), &decode = getCounters(Stage::decode);
+    const StageCounters &coded = encode.calls != 0 ? encode : decode;
+    const std::uint64_t compressedBytes = encode.calls != 0 ? coded.bytesOut : coded.bytesIn;
+    if (compressedBytes != 0) {
+        output << ",\"compressionRatio\":" << (double) coded.symbols * 3 / 8 / (double) compressedBytes;
+    }
+    output << ",\"seconds\":" << runTime.count() << ",\"peakRssKiB\":" << getPeakRssKiB() << "}" << std::endl;
+}
+
+long getPeakRssKiB() {
+#ifdef __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+    return 0;
+}
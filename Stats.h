@@ -0,0 +1,113 @@
+#ifndef MID_CRACK_CODE_STATS_H
+#define MID_CRACK_CODE_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Statistics of the stages of a run, printed as JSON with --stats. The stages add their time, bytes and digits to
+// global counters, from any thread, while the statistics are enabled. Without MID_CRACK_CODE_STATS (the CMake option
+// of the same name) the timers and counters are empty inline functions, so they cost nothing.
+
+/// Stages of the pipeline that are timed.
+enum class Stage {
+    parseHeader, // headers of .bmp files and compressed files
+    readFile,
+    binarize, // luminance, threshold and packing of the pixels into the bitmap
+    findStarts, // search for the first pixel of every contour
+    trace,
+    parseCode, // text and .mcc mid-crack codes
+    encode,
+    decode,
+    reconstruct, // drawing the contours into a bitmap
+    measure, // shape metrics of the chains
+    writeFile
+};
+
+const int numberOfStages = 11;
+
+#ifdef MID_CRACK_CODE_STATS
+const bool statsCompiled = true;
+
+namespace statsDetail {
+    extern bool enabled;
+
+    void addTime(Stage stage, std::chrono::steady_clock::duration time);
+
+    void addBytes(Stage stage, std::uint64_t bytesIn, std::uint64_t bytesOut);
+
+    void addSymbols(Stage stage, std::uint64_t symbols);
+
+    void recordLzwDictionary(std::size_t dictionarySize, int codeWidth);
+}
+
+/// \return True if the stages are being timed. It is only set before the work starts, so it is read without locking.
+inline bool isStatsEnabled() { return statsDetail::enabled; }
+
+/// Add bytes read and written by a stage.
+inline void addStageBytes(Stage stage, std::uint64_t bytesIn, std::uint64_t bytesOut) {
+    if (statsDetail::enabled) statsDetail::addBytes(stage, bytesIn, bytesOut);
+}
+
+/// Add digits (or pixels, for the stages before tracing) processed by a stage.
+inline void addStageSymbols(Stage stage, std::uint64_t symbols) {
+    if (statsDetail::enabled) statsDetail::addSymbols(stage, symbols);
+}
+
+/// Record the size of the dictionary and the width of the codes at the end of an LZW stream; the largest ones are kept.
+inline void recordLzwDictionary(std::size_t dictionarySize, int codeWidth) {
+    if (statsDetail::enabled) statsDetail::recordLzwDictionary(dictionarySize, codeWidth);
+}
+
+/// Adds the time from its construction to its destruction to a stage. The times of the threads that run a stage at
+/// the same time add up, so the time of a parallel stage can be more than the time of the run.
+class StageTimer {
+private:
+    Stage stage;
+    bool running;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit StageTimer(Stage stage) : stage(stage), running(statsDetail::enabled) {
+        if (running) start = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer() {
+        if (running) statsDetail::addTime(stage, std::chrono::steady_clock::now() - start);
+    }
+
+    StageTimer(const StageTimer &) = delete;
+
+    StageTimer &operator=(const StageTimer &) = delete;
+};
+#else
+const bool statsCompiled = false;
+
+inline bool isStatsEnabled() { return false; }
+
+inline void addStageBytes(Stage, std::uint64_t, std::uint64_t) {}
+
+inline void addStageSymbols(Stage, std::uint64_t) {}
+
+inline void recordLzwDictionary(std::size_t, int) {}
+
+class StageTimer {
+public:
+    explicit StageTimer(Stage) {}
+};
+#endif
+
+/// Start timing the stages and the whole run. Call it before any work starts.
+void enableStats();
+
+/// Write the statistics since enableStats as a single line of JSON: for every stage that ran, the number of times it
+/// ran, its time in seconds, the bytes in and out and the digits it processed, then the LZW dictionary, the compression
+/// ratio (digits packed in 3 bits to compressed bytes), the time of the run and the peak memory.
+void writeStatsJson(std::ostream &output);
+
+/// \return Peak resident memory of the process in KiB, 0 where it is not known.
+long getPeakRssKiB();
+
+
+#endif //MID_CRACK_CODE_STATS_H
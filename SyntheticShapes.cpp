@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "SyntheticShapes.h"
+
+namespace {
+    const double pi = 3.14159265358979323846;
+
+//    uniform number in [0, 1) from the raw output of the generator, which is the same on every platform
+    double uniform(std::mt19937 &random) {
+        return random() / 4294967296.0;
+    }
+
+//    pseudo-random value in [0, 1) of a lattice point of the noise
+    double latticeValue(std::int64_t x, std::int64_t y, std::uint32_t seed) {
+        std::uint64_t h = (std::uint64_t) x * 0x9E3779B97F4A7C15ull ^ (std::uint64_t) y * 0xC2B2AE3D27D4EB4Full ^ seed;
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 29;
+        return (double) (h >> 11) / 9007199254740992.0;
+    }
+
+//    smooth noise in [0, 1) with features of about `scale` pixels, interpolated between lattice points
+    double valueNoise(double x, double y, double scale, std::uint32_t seed) {
+        x /= scale;
+        y /= scale;
+        const double x0 = std::floor(x), y0 = std::floor(y);
+        const double fx = x - x0, fy = y - y0;
+        const double sx = fx * fx * (3 - 2 * fx), sy = fy * fy * (3 - 2 * fy);
+        const auto ix = (std::int64_t) x0, iy = (std::int64_t) y0;
+        const double top = latticeValue(ix, iy, seed) * (1 - sx) + latticeValue(ix + 1, iy, seed) * sx;
+        const double bottom = latticeValue(ix, iy + 1, seed) * (1 - sx) + latticeValue(ix + 1, iy + 1, seed) * sx;
+        return top * (1 - sy) + bottom * sy;
+    }
+
+//    sum of octaves of noise, each half the scale and half the weight of the previous one, in [0, 1)
+    double fractalNoise(double x, double y, double scale, int octaves, std::uint32_t seed) {
+        double sum = 0, weight = 0.5, totalWeight = 0;
+        for (int octave = 0; octave < octaves; ++octave) {
+            sum += weight * valueNoise(x, y, scale, seed + octave);
+            totalWeight += weight;
+            scale /= 2;
+            weight /= 2;
+        }
+        return sum / totalWeight;
+    }
+
+    void fillDisc(Bitmap &bitmap, double centerX, double centerY, double radius) {
+        const int y0 = std::max(0, (int) std::ceil(centerY - radius));
+        const int y1 = std::min(bitmap.getHeight() - 1, (int) std::floor(centerY + radius));
+        for (int y = y0; y <= y1; ++y) {
+            const double halfWidth = std::sqrt(std::max(0.0, radius * radius - (y - centerY) * (y - centerY)));
+            const int x0 = std::max(0, (int) std::ceil(centerX - halfWidth));
+            const int x1 = std::min(bitmap.getWidth(), (int) std::floor(centerX + halfWidth) + 1);
+            bitmap.setRun(y, x0, x1);
+        }
+    }
+
+    void generateDiscs(Bitmap &bitmap, int size, std::uint32_t seed) {
+        std::mt19937 random(seed);
+        const int numberOfDiscs = std::max(1, (int) ((std::int64_t) size * size / 20000));
+        for (int i = 0; i < numberOfDiscs; ++i) {
+            const double x = uniform(random) * size, y = uniform(random) * size;
+            const double radius = size / 400.0 + uniform(random) * uniform(random) * size / 25.0;
+            fillDisc(bitmap, x, y, radius);
+        }
+    }
+
+    void generateSpiral(Bitmap &bitmap, int size) {
+        const double center = size / 2.0;
+        const double pitch = std::max(8.0, size / 24.0); // distance between turns
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const double dx = x + 0.5 - center, dy = y + 0.5 - center;
+                const double turn = std::atan2(dy, dx) / (2 * pi) + 0.5; // in [0, 1]
+                const double phase = std::fmod(std::sqrt(dx * dx + dy * dy) / pitch - turn + 1, 1.0);
+                if (phase < 0.45) bitmap.set(x, y);
+            }
+        }
+    }
+
+    void generateCoastline(Bitmap &bitmap, int size, std::uint32_t seed) {
+        const double center = size / 2.0;
+//        octaves down to features of 2 pixels, so the coastline stays rough at every size
+        int octaves = 1;
+        while ((size >> (octaves + 2)) > 2) ++octaves;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const double dx = (x - center) / center, dy = (y - center) / center;
+                const double land = fractalNoise(x, y, size / 4.0, octaves, seed) + 0.45 - 0.6 * (dx * dx + dy * dy);
+                if (land > 0.5) bitmap.set(x, y);
+            }
+        }
+    }
+
+    void generateBlobs(Bitmap &bitmap, int size, std::uint32_t seed) {
+        const double scale = std::max(8.0, size / 64.0);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                if (fractalNoise(x, y, scale, 2, seed) > 0.55) bitmap.set(x, y);
+            }
+        }
+    }
+
+    void generateGlyphs(Bitmap &bitmap, int size, std::uint32_t seed) {
+//        glyphs of 5 x 7 cells of 2 x 2 pixels with a margin, in lines with a gap between them
+        const int cell = 2, glyphWidth = 6 * cell, lineHeight = 10 * cell;
+        std::mt19937 random(seed);
+        for (int top = cell; top + 7 * cell <= size; top += lineHeight) {
+            for (int left = cell; left + 5 * cell <= size; left += glyphWidth) {
+                if (uniform(random) < 0.15) continue; // space between words
+                for (int row = 0; row < 7; ++row) {
+                    const std::uint32_t bits = random();
+                    for (int column = 0; column < 5; ++column) {
+                        if ((bits >> column) % 8 < 3) continue; // about 60% of the cells are black
+                        for (int y = top + row * cell; y < top + (row + 1) * cell; ++y) {
+                            bitmap.setRun(y, left + column * cell, left + (column + 1) * cell);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+const char *getSyntheticShapeName(SyntheticShape shape) {
+    switch (shape) {
+        case SyntheticShape::discs:
+            return "discs";
+        case SyntheticShape::spiral:
+            return "spiral";
+        case SyntheticShape::coastline:
+            return "coastline";
+        case SyntheticShape::blobs:
+            return "blobs";
+        case SyntheticShape::glyphs:
+            return "glyphs";
+    }
+    return "";
+}
+
+bool findSyntheticShape(const std::string &name, SyntheticShape &shape) {
+    for (SyntheticShape candidate : allSyntheticShapes) {
+        if (name == getSyntheticShapeName(candidate)) {
+            shape = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+Bitmap generateSyntheticShape(SyntheticShape shape, int size, std::uint32_t seed) {
+    Bitmap bitmap(size, size);
+    switch (shape) {
+        case SyntheticShape::discs:
+            generateDiscs(bitmap, size, seed);
+            break;
+        case SyntheticShape::spiral:
+            generateSpiral(bitmap, size);
+            break;
+        case SyntheticShape::coastline:
+            generateCoastline(bitmap, size, seed);
+            break;
+        case SyntheticShape::blobs:
+            generateBlobs(bitmap, size, seed);
+            break;
+        case SyntheticShape::glyphs:
+            generateGlyphs(bitmap, size, seed);
+            break;
+    }
+    return bitmap;
+}
@@ -0,0 +1,29 @@
+#ifndef MID_CRACK_CODE_SYNTHETICSHAPES_H
+#define MID_CRACK_CODE_SYNTHETICSHAPES_H
+
+#include <cstdint>
+#include <string>
+#include "Bitmap.h"
+
+/// Kinds of synthetic binary images for benchmarks, from few long contours to many short ones.
+enum class SyntheticShape {
+    discs, // scattered filled discs of many sizes
+    spiral, // a thick spiral band from the centre to the border
+    coastline, // an island with a fractal coastline, lakes and islets
+    blobs, // thresholded smooth noise
+    glyphs // rows of small random glyphs, like a page of text
+};
+
+const SyntheticShape allSyntheticShapes[] = {SyntheticShape::discs, SyntheticShape::spiral, SyntheticShape::coastline,
+                                             SyntheticShape::blobs, SyntheticShape::glyphs};
+
+const char *getSyntheticShapeName(SyntheticShape shape);
+
+/// \return False if there is no shape with that name.
+bool findSyntheticShape(const std::string &name, SyntheticShape &shape);
+
+/// Generate a square image of a shape. The same seed gives the same image on every platform.
+Bitmap generateSyntheticShape(SyntheticShape shape, int size, std::uint32_t seed);
+
+
+#endif //MID_CRACK_CODE_SYNTHETICSHAPES_H
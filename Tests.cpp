@@ -0,0 +1,169 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MidCrack.h"
+
+// Tests of the library and of the command line program, run by ctest. The first argument is the name of the test and
+// the second the path of the mid_crack_code program; every test works in its own temporary directory.
+
+namespace {
+    void require(bool condition, const std::string &what) {
+        if (!condition) throw std::runtime_error("Failed: " + what);
+    }
+
+    void requireOk(const MidCrackStatus &status, const std::string &what) {
+        require(status.ok(), what + " (" + status.message + ")");
+    }
+
+    /// Run the program with the arguments.
+    /// \return True if it exits with 0.
+    bool runProgram(const std::string &program, const std::string &arguments) {
+        return std::system(("\"" + program + "\" " + arguments).c_str()) == 0;
+    }
+
+    std::vector<unsigned char> readFile(const std::filesystem::path &fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        require(file.is_open(), "open " + fileName.string());
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    void writeFile(const std::filesystem::path &fileName, const std::vector<unsigned char> &bytes) {
+        std::ofstream file(fileName, std::ios::binary);
+        require(file.is_open(), "open " + fileName.string());
+        file.write((const char *) bytes.data(), (std::streamsize) bytes.size());
+    }
+
+//    a disc of the given radius in the middle of a square image, so its contour reaches left of its first pixel
+    Bitmap makeDisc(int size, int radius) {
+        Bitmap bitmap(size, size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const int dx = x - size / 2, dy = y - size / 2;
+                if (dx * dx + dy * dy <= radius * radius) bitmap.set(x, y);
+            }
+        }
+        return bitmap;
+    }
+
+    void writeBmpFile(const std::filesystem::path &fileName, const Bitmap &bitmap) {
+        std::vector<unsigned char> bytes;
+        requireOk(writeBmpBytes(bitmap, bytes), "writeBmpBytes");
+        writeFile(fileName, bytes);
+    }
+
+//    -m and then -c --legacy give a legacy file that draws the same image as the traced code
+    void testLegacyCompressCli(const std::string &program, const std::filesystem::path &directory) {
+        writeBmpFile(directory / "disc.bmp", makeDisc(40, 12));
+        const std::string disc = (directory / "disc").string();
+        require(runProgram(program, "-m " + disc + ".bmp " + disc + ".txt"), "-m");
+        require(runProgram(program, "-c " + disc + ".txt " + disc + ".bin --legacy"), "-c --legacy");
+        require(runProgram(program, "-d " + disc + ".bin " + disc + "2.txt"), "-d of the legacy file");
+        require(runProgram(program, "-i " + disc + ".txt " + disc + "1.bmp"), "-i of the traced code");
+        require(runProgram(program, "-i " + disc + "2.txt " + disc + "2.bmp"), "-i of the decompressed code");
+        require(readFile(disc + "1.bmp") == readFile(disc + "2.bmp"), "same image after the legacy format");
+    }
+
+//    -mc --legacy writes the same file as -m and -c --legacy
+    void testLegacyTraceCompressCli(const std::string &program, const std::filesystem::path &directory) {
+        writeBmpFile(directory / "disc.bmp", makeDisc(40, 12));
+        const std::string disc = (directory / "disc").string();
+        require(runProgram(program, "-mc " + disc + ".bmp " + disc + "1.bin --legacy"), "-mc --legacy");
+        require(runProgram(program, "-m " + disc + ".bmp " + disc + ".txt"), "-m");
+        require(runProgram(program, "-c " + disc + ".txt " + disc + "2.bin --legacy"), "-c --legacy");
+        require(readFile(disc + "1.bin") == readFile(disc + "2.bin"), "same legacy file");
+    }
+
+//    the legacy format of MidCrackEncoder::compress draws the same image as the traced code, from a bitmap and from a
+//    stream, and codes of several contours are refused
+    void testLegacyLibrary(const std::string &, const std::filesystem::path &) {
+        MidCrackEncoderOptions options;
+        options.legacyFormat = true;
+        MidCrackEncoder encoder(options, 2);
+        MidCrackDecoder decoder({}, 2);
+        const Bitmap disc = makeDisc(40, 12);
+        MidCrackCode traced;
+        requireOk(encoder.trace(disc, traced), "trace");
+        Bitmap expected;
+        requireOk(decoder.draw(traced, expected), "draw the traced code");
+        std::vector<unsigned char> expectedBytes;
+        requireOk(writeBmpBytes(expected, expectedBytes), "writeBmpBytes");
+
+        std::vector<unsigned char> fromBitmap;
+        requireOk(encoder.compress(disc, fromBitmap), "compress a bitmap in the legacy format");
+        Bitmap drawn;
+        requireOk(decoder.decompressToBitmap(fromBitmap, drawn), "decompress the legacy format");
+        std::vector<unsigned char> drawnBytes;
+        requireOk(writeBmpBytes(drawn, drawnBytes), "writeBmpBytes");
+        require(drawnBytes == expectedBytes, "same image after the legacy format");
+
+        std::vector<unsigned char> image;
+        requireOk(writeBmpBytes(disc, image), "writeBmpBytes");
+        std::string imageBytes(image.begin(), image.end());
+        std::istringstream imageStream(imageBytes);
+        std::ostringstream fromStream;
+        requireOk(encoder.compress(imageStream, defaultThreshold, fromStream),
+                  "compress a stream in the legacy format");
+        require(fromStream.str() == std::string(fromBitmap.begin(), fromBitmap.end()), "same legacy bytes");
+
+        options.tracing.allContours = true;
+        MidCrackEncoder allContours(options, 2);
+        const MidCrackStatus status = allContours.compress(disc, fromBitmap);
+        require(!status.ok(), "all the contours are refused in the legacy format");
+    }
+
+//    a white image traced with --all has an image size and no chains, and -i and -di draw the white image again
+    void testBlankRoundTripCli(const std::string &program, const std::filesystem::path &directory) {
+        writeBmpFile(directory / "blank.bmp", Bitmap(8, 4));
+        const std::string blank = (directory / "blank").string();
+        require(runProgram(program, "-m " + blank + ".bmp " + blank + ".txt --all"), "-m --all");
+        require(runProgram(program, "-i " + blank + ".txt " + blank + "1.bmp"), "-i of a code without chains");
+        require(readFile(blank + "1.bmp") == readFile(blank + ".bmp"), "white image after -m and -i");
+        require(runProgram(program, "-mc " + blank + ".bmp " + blank + ".bin --all"), "-mc --all");
+        require(runProgram(program, "-di " + blank + ".bin " + blank + "2.bmp"), "-di of a code without chains");
+        require(readFile(blank + "2.bmp") == readFile(blank + ".bmp"), "white image after -mc and -di");
+    }
+
+    struct Test {
+        const char *name;
+        std::function<void(const std::string &program, const std::filesystem::path &directory)> run;
+    };
+
+    const Test tests[] = {
+            {"legacy-compress-cli", testLegacyCompressCli},
+            {"legacy-trace-compress-cli", testLegacyTraceCompressCli},
+            {"legacy-library", testLegacyLibrary},
+            {"blank-round-trip-cli", testBlankRoundTripCli},
+    };
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: mid_crack_code_tests [test] [mid_crack_code program]" << std::endl;
+        return 1;
+    }
+    const std::string name = argv[1], program = argc > 2 ? argv[2] : "";
+    for (const Test &test : tests) {
+        if (name != test.name) continue;
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+                                                ("mid_crack_code_tests_" + name);
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        try {
+            test.run(program, directory);
+        } catch (const std::exception &error) {
+            std::cerr << name << ": " << error.what() << std::endl;
+            return 1;
+        }
+        std::filesystem::remove_all(directory);
+        return 0;
+    }
+    std::cout << "Unknown test " << name << "." << std::endl;
+    return 1;
+}
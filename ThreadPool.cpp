@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <exception>
+#include "ThreadPool.h"
+
+namespace {
+//    pool and index of the worker that runs the current thread
+    thread_local const ThreadPool *currentPool = nullptr;
+    thread_local int currentWorker = -1;
+}
+
+ThreadPool::ThreadPool(unsigned numberOfThreads) {
+    if (numberOfThreads == 0) numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < numberOfThreads; ++i) queues.push_back(std::make_unique<TaskQueue>());
+    for (unsigned i = 0; i < numberOfThreads; ++i) {
+        workers.emplace_back(&ThreadPool::runWorker, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+int ThreadPool::getWorkerIndex() const {
+    return currentPool == this ? currentWorker : -1;
+}
+
+bool ThreadPool::takeTask(unsigned worker, std::function<void()> &task) {
+    for (unsigned i = 0; i < queues.size(); ++i) {
+        TaskQueue &queue = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        if (i == 0) { // own queue
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        } else { // steal the task the owner would run last
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        --queuedTasks;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::runWorker(unsigned worker) {
+    currentPool = this;
+    currentWorker = (int) worker;
+    while (true) {
+        std::function<void()> task;
+        if (!takeTask(worker, task)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || queuedTasks > 0; });
+            if (queuedTasks == 0) return; // stopping
+            continue;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--unfinishedTasks == 0) allTasksDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++unfinishedTasks;
+    }
+    const int worker = getWorkerIndex();
+    TaskQueue &queue = *queues[worker >= 0 ? (unsigned) worker : nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        ++queuedTasks;
+    }
+//    a worker that found no task before the task was queued is waiting once the mutex is free, so it gets the notify
+    { std::lock_guard<std::mutex> lock(mutex); }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    allTasksDone.wait(lock, [this] { return unfinishedTasks == 0; });
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &body) {
+    auto next = std::make_shared<std::atomic<std::size_t>>(0);
+//    the first exception thrown by body, which is thrown again on the calling thread
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    for (unsigned i = 0; i < getNumberOfThreads() && i < count; ++i) {
+        submit([next, count, &body, &error, &errorMutex] {
+            try {
+                for (std::size_t index = (*next)++; index < count; index = (*next)++) body(index);
+            } catch (...) {
+                *next = count; // no more calls
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+        });
+    }
+    wait();
+    if (error) std::rethrow_exception(error);
+}
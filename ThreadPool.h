@@ -0,0 +1,67 @@
+#ifndef MID_CRACK_CODE_THREADPOOL_H
+#define MID_CRACK_CODE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads that run submitted tasks.
+/// Every worker has its own queue of tasks. Tasks submitted by a worker go to its own queue and the others are spread
+/// over the queues in turn; a worker runs the tasks of its queue in order and steals from the back of the other queues
+/// when its own is empty, so the workers stay busy without contending for a single queue.
+class ThreadPool {
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::atomic<unsigned> nextQueue{};
+//    guards stopping and unfinishedTasks, and the sleeping of idle workers
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allTasksDone;
+    std::atomic<std::size_t> queuedTasks{};
+    std::size_t unfinishedTasks{};
+    bool stopping{};
+
+    bool takeTask(unsigned worker, std::function<void()> &task);
+
+    void runWorker(unsigned worker);
+
+public:
+    /// \param numberOfThreads 0 uses one thread per hardware thread.
+    explicit ThreadPool(unsigned numberOfThreads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] unsigned getNumberOfThreads() const { return (unsigned) workers.size(); }
+
+    /// \return Index of the worker of this pool that runs the calling thread, or -1 if it is not one of them.
+    [[nodiscard]] int getWorkerIndex() const;
+
+    void submit(std::function<void()> task);
+
+    /// Wait until all submitted tasks are finished.
+    void wait();
+
+    /// Call body(i) for every i in [0, count) on the worker threads and wait until all calls are finished.
+    /// Indices are handed out in order, one at a time, so long and short calls balance out.
+    /// If a call throws, no more calls start and the first exception is thrown again once the calls are finished.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+};
+
+
+#endif //MID_CRACK_CODE_THREADPOOL_H
@@ -1,146 +1,262 @@
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <vector>
-#include <algorithm>
-#include <cmath>
-#include "Image.h"
+#include <limits>
+#include "Batch.h"
+#include "Error.h"
+#include "Files.h"
+#include "MidCrack.h"
+#include "Stats.h"
 
 void printUsage();
 
-void addMidCrackCodeOfImageToFile(const std::string &fileName, Image *image);
+template<typename Number>
+bool parseNumberSetting(const std::string &setting, Number &value);
 
-std::string convertToMidCrackCode(Image *image);
+/// Throw the error of a library call that failed, so it is reported like the other errors.
+void checkStatus(const MidCrackStatus &status);
 
-Image *convertFromMidCrackCode(const std::string &fileName);
-
-void compressMidCrackCode(const std::string& midCrackCodeFile, const std::string& compressionOutputFile);
-
-void decompressMidCrackCode(const std::string& inputCompressedFile, const std::string& outputMidCrackCodeFile);
+void writeShapeMetrics(const std::string &fileName, const std::vector<ShapeMetrics> &metrics);
 
 int main(int argc, char *argv[]) {
-    if (argc < 4 || argc > 5) {
+    const bool batch = argc > 1 && std::string(argv[1]) == "-b";
+    if (argc < (batch ? 5 : 4)) {
         std::cout << "Wrong arguments." << std::endl;
         printUsage();
         exit(1);
     }
-    std::string option = argv[1];
+    std::string option = argv[batch ? 2 : 1];
+    const std::string input = argv[batch ? 3 : 2], output = argv[batch ? 4 : 3];
+
+    // optional settings after the file names
+    int threshold = defaultThreshold;
+    MidCrackEncoderOptions encoderOptions;
+    TracingSettings &tracingSettings = encoderOptions.tracing;
+    CompressionSettings &compressionSettings = encoderOptions.compression;
+    bool &legacyFormat = encoderOptions.legacyFormat;
+    MidCrackDecoderOptions decoderOptions;
+    bool &filled = decoderOptions.filled;
+    bool stats = false;
+    bool onlyPart = false;
+    std::uint64_t firstDigit = 0, numberOfDigits = UINT64_MAX;
+    ImageFormat imageFormat = ImageFormat::bmp24;
+    std::string dictionaryFile;
+    std::size_t dictionarySize = lzwDefaultDictionaryStrings;
+    for (int i = batch ? 5 : 4; i < argc; ++i) {
+        std::string setting = argv[i];
+        bool valid = true;
+        if (setting == "--all") {
+            tracingSettings.allContours = true;
+        } else if (setting == "--holes") {
+            tracingSettings.allContours = true;
+            tracingSettings.holes = true;
+        } else if (setting == "--threshold=otsu") {
+            threshold = otsuThreshold;
+        } else if (setting.starts_with("--threshold=")) {
+            valid = parseNumberSetting(setting, threshold) && threshold <= 256;
+        } else if (setting == "--engine=trace" || setting == "--engine=tiled" || setting == "--engine=stream") {
+            tracingSettings.engine = setting == "--engine=tiled" ? TracingEngine::tiled
+                                   : setting == "--engine=stream" ? TracingEngine::stream : TracingEngine::trace;
+        } else if (setting.starts_with("--stripe-height=")) {
+            int &stripeHeight = tracingSettings.stripeHeight;
+            valid = parseNumberSetting(setting, stripeHeight) && stripeHeight > 0;
+        } else if (setting == "--fill") {
+            filled = true;
+        } else if (setting.starts_with("--image-format=")) {
+            const std::string format = setting.substr(setting.find('=') + 1);
+            valid = format == "bmp24" || format == "bmp8" || format == "bmp1" || format == "pbm";
+            imageFormat = format == "bmp8" ? ImageFormat::bmp8 : format == "bmp1" ? ImageFormat::bmp1
+                        : format == "pbm" ? ImageFormat::pbm : ImageFormat::bmp24;
+        } else if (setting == "--stats") {
+            stats = true;
+            valid = statsCompiled;
+        } else if (setting == "--legacy") {
+            legacyFormat = true;
+        } else if (setting == "--codec=lzw" || setting == "--codec=turns") {
+            compressionSettings.codec = setting == "--codec=lzw" ? CodecType::lzw : CodecType::turns;
+        } else if (setting.starts_with("--context-order=")) {
+            int &contextOrder = compressionSettings.contextOrder;
+            valid = parseNumberSetting(setting, contextOrder) && contextOrder <= turnsMaxContextOrder;
+        } else if (setting.starts_with("--max-code-width=")) {
+            int &maxCodeWidth = compressionSettings.maxCodeWidth;
+            valid = parseNumberSetting(setting, maxCodeWidth) && maxCodeWidth >= lzwMinCodeWidth &&
+                    maxCodeWidth <= lzwMaxCodeWidth;
+        } else if (setting == "--full-dictionary=reset" || setting == "--full-dictionary=freeze") {
+            compressionSettings.resetWhenFull = setting == "--full-dictionary=reset";
+        } else if (setting.starts_with("--dictionary=")) {
+            dictionaryFile = setting.substr(setting.find('=') + 1);
+            valid = !dictionaryFile.empty();
+        } else if (setting.starts_with("--dictionary-size=")) {
+            valid = parseNumberSetting(setting, dictionarySize) && dictionarySize > 0 &&
+                    dictionarySize < (std::size_t(1) << lzwMaxCodeWidth) - 10;
+        } else if (setting.starts_with("--block-size=")) {
+            std::uint32_t &symbolsPerBlock = compressionSettings.symbolsPerBlock;
+            valid = parseNumberSetting(setting, symbolsPerBlock) && symbolsPerBlock > 0;
+        } else if (setting.starts_with("--seek=")) {
+            valid = parseNumberSetting(setting, firstDigit);
+            onlyPart = true;
+        } else if (setting.starts_with("--count=")) {
+            valid = parseNumberSetting(setting, numberOfDigits);
+            onlyPart = true;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cout << "Wrong arguments." << std::endl;
+            printUsage();
+            exit(1);
+        }
+    }
+
+    // the operation on one file, which a batch runs for every input file
+    BatchOperation operation;
+    std::string outputExtension;
     if (option == "-m") { // convert to mid-crack code
-        auto *image = new Image(argv[2]);
-        addMidCrackCodeOfImageToFile(argv[3], image);
-        delete image;
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            std::ifstream image = openInputFile(inputFile);
+            MidCrackCode midCrackCode;
+            checkStatus(MidCrackEncoder(encoderOptions, worker.pool).trace(image, threshold, midCrackCode));
+            writeMidCrackCode(outputFile, midCrackCode);
+        };
+        outputExtension = ".txt";
     } else if (option == "-i") { // convert from mid-crack code
-        auto *convertedImage = convertFromMidCrackCode(argv[2]);
-        convertedImage->saveImage(argv[3]);
-        delete convertedImage;
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            MidCrackCode midCrackCode;
+            checkStatus(readMidCrackCodeBytes(worker.input, midCrackCode));
+            Bitmap bitmap;
+            checkStatus(MidCrackDecoder(decoderOptions, worker.pool).draw(midCrackCode, bitmap));
+            saveBitmap(outputFile, std::move(bitmap), imageFormat);
+        };
+        outputExtension = imageFormat == ImageFormat::pbm ? ".pbm" : ".bmp";
     } else if (option == "-c") { // compress mid-crack code
-        compressMidCrackCode(argv[2], argv[3]);
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            MidCrackCode midCrackCode;
+            checkStatus(readMidCrackCodeBytes(worker.input, midCrackCode));
+            checkStatus(MidCrackEncoder(encoderOptions, worker.pool).compress(midCrackCode, worker.output));
+            writeWholeFile(outputFile, worker.output);
+        };
+        outputExtension = ".bin";
     } else if (option == "-d") { // decompressing mid-crack code
-        decompressMidCrackCode(argv[2], argv[3]);
-    } else printUsage();
-
-    return 0;
-}
-
-void decompressMidCrackCode(const std::string& inputCompressedFile, const std::string& outputMidCrackCodeFile) {
-    // open .bin file with compressed mid-crack code
-    std::ifstream inputFile(inputCompressedFile, std::ios::in | std::ios::binary);
-    if (!inputFile.is_open()) {
-        std::cout << "The inputFile could not be opened." << std::endl;
-        exit(1);
-    }
-
-    // LZW decompression
-    // create output .txt file for the mid-crack code
-    std::ofstream midCrackCodeFile(outputMidCrackCodeFile);
-    if (!midCrackCodeFile.is_open()) {
-        std::cout << "the midCrackCodeFile could not be opened." << std::endl;
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            MidCrackDecoder decoder(decoderOptions, worker.pool);
+            MidCrackCode midCrackCode;
+            checkStatus(onlyPart ? decoder.decompress(worker.input, firstDigit, numberOfDigits, midCrackCode)
+                                 : decoder.decompress(worker.input, midCrackCode));
+            writeMidCrackCode(outputFile, midCrackCode);
+        };
+        outputExtension = ".txt";
+    } else if (option == "-mc") { // convert to compressed mid-crack code
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            MidCrackEncoder encoder(encoderOptions, worker.pool);
+            if (tracingSettings.engine == TracingEngine::stream) {
+//                the blocks are written as the rows of the image are read and traced
+                std::ifstream image = openInputFile(inputFile);
+                std::ofstream compressed(outputFile, std::ios::binary);
+                if (!compressed.is_open()) {
+                    throw MidCrackCodeError("The file could not be opened.");
+                }
+                checkStatus(encoder.compress(image, threshold, compressed));
+                return;
+            }
+            std::ifstream imageFile = openInputFile(inputFile);
+            Image image(imageFile, threshold);
+            checkStatus(encoder.compress(image.getBitmap(), worker.output));
+            writeWholeFile(outputFile, worker.output);
+        };
+        outputExtension = ".bin";
+    } else if (option == "-di") { // convert from compressed mid-crack code
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            Bitmap bitmap;
+            checkStatus(MidCrackDecoder(decoderOptions, worker.pool).decompressToBitmap(worker.input, bitmap));
+            saveBitmap(outputFile, std::move(bitmap), imageFormat);
+        };
+        outputExtension = imageFormat == ImageFormat::pbm ? ".pbm" : ".bmp";
+    } else if (option == "-s") { // shape metrics of mid-crack code
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            MidCrackCode midCrackCode;
+            checkStatus(readMidCrackCodeBytes(worker.input, midCrackCode));
+            std::vector<ShapeMetrics> metrics;
+            checkStatus(measureShapes(midCrackCode, metrics));
+            writeShapeMetrics(outputFile, metrics);
+        };
+        outputExtension = ".json";
+    } else if (option == "-ds") { // shape metrics of compressed mid-crack code
+        operation = [&](const std::string &inputFile, const std::string &outputFile, BatchWorker &worker) {
+            readWholeFile(inputFile, worker.input);
+            std::vector<ShapeMetrics> metrics;
+            checkStatus(MidCrackDecoder(decoderOptions, worker.pool).measureShapes(worker.input, metrics));
+            writeShapeMetrics(outputFile, metrics);
+        };
+        outputExtension = ".json";
+    } else if (option == "-t" && !batch) { // train an LZW dictionary
+        operation = [&](const std::string &inputSource, const std::string &outputFile, BatchWorker &worker) {
+            const std::vector<std::string> corpus = findBatchInputs(inputSource);
+            LzwDictionaryTrainer trainer;
+            for (const std::string &inputFile : corpus) {
+                MidCrackCode midCrackCode;
+                try {
+                    readWholeFile(inputFile, worker.input);
+                    checkStatus(readMidCrackCodeBytes(worker.input, midCrackCode));
+                } catch (const MidCrackCodeError &error) {
+                    throw MidCrackCodeError(inputFile + ": " + error.what(), error.getExitCode());
+                }
+                for (const auto &chain : midCrackCode.chains) trainer.addChain(chain.code);
+            }
+            const LzwDictionary dictionary = trainer.train(dictionarySize);
+            checkStatus(writeLzwDictionaryBytes(dictionary, worker.output));
+            writeWholeFile(outputFile, worker.output);
+            std::cout << "Trained " << dictionary.getEntries().size() << " strings from " << corpus.size()
+                      << " files, dictionary ID " << std::hex << std::setfill('0') << std::setw(8)
+                      << dictionary.getId() << "." << std::dec << std::endl;
+        };
+    } else if (option == "-t") { // the training reads all the files of its input itself
+        std::cout << "Wrong arguments: -t trains one dictionary from all its input files and cannot be used with -b."
+                  << std::endl;
         exit(1);
+    } else {
+        printUsage();
+        return 0;
     }
 
-    // get number of bytes required for the output codes
-    unsigned char numberOfBytesInCode;
-    inputFile >> numberOfBytesInCode;
-
-    unsigned int prevCode;
-    inputFile.read((char*)&prevCode, numberOfBytesInCode);
-
-    std::vector<std::string> table = {"0", "1", "2", "3", "4", "5", "6", "7"}; // init table
-    std::string S, C;
-    midCrackCodeFile << table[prevCode];
-    while (inputFile.peek() != EOF) {
-        unsigned int nextCode;
-        inputFile.read((char*) (&nextCode), numberOfBytesInCode);
-        if (nextCode >= table.size()) { // if nextCode is not in table
-            S = table[prevCode];
-            S.append(C);
-        } else { // nextCode is in table
-            S = table[nextCode];
+    if (stats) enableStats();
+    int exitCode;
+    try {
+//        the dictionary is shared by the encoder and the decoder of every file
+        if (!dictionaryFile.empty()) {
+            std::vector<unsigned char> bytes;
+            readWholeFile(dictionaryFile, bytes);
+            checkStatus(readLzwDictionaryBytes(bytes, decoderOptions.dictionary));
+            compressionSettings.dictionary = decoderOptions.dictionary;
         }
-        midCrackCodeFile << S;
-        C = S[0];
-        table.push_back(table[prevCode] + C); // add translation of prevCode + C to table
-        prevCode = nextCode;
-    }
-
-    inputFile.close();
-    midCrackCodeFile.close();
-}
-
-void compressMidCrackCode(const std::string& midCrackCodeFile, const std::string& compressionOutputFile) {
-    // read mid-crack code from inputFile
-    std::string midCrackCode;
-    std::ifstream inputFile(midCrackCodeFile, std::ios::binary);
-    if (!inputFile.is_open()) {
-        std::cout << "The inputFile could not be opened." << std::endl;
-        exit(1);
-    }
-    std::istreambuf_iterator<char> inputIt(inputFile), emptyInputIt;
-    std::back_insert_iterator<std::string> stringInsert(midCrackCode);
-    copy(inputIt, emptyInputIt, stringInsert);
-    inputFile.close();
-
-    // LZW
-    std::vector<int> output;
-    std::vector<std::string> table = {"0", "1", "2", "3", "4", "5", "6", "7"}; // init table
-    std::string P(1, midCrackCode[0]); // set P to the first character of the mid-crack code
-    bool first = true;
-    for (char C : midCrackCode) {
-        if (first) { first = false; continue; } // skip first iteration
-        if (std::find(table.begin(), table.end(), P + C) != table.end()) { // if P + C is in table
-            P += C; // add C to P
+        if (!batch) {
+//            a single file uses all the threads
+            BatchWorker worker(0);
+            operation(input, output, worker);
+            exitCode = 0;
         } else {
-            // add code for P to output
-            auto it = find(table.begin(), table.end(), P);
-            int index = it - table.begin();
-            output.push_back(index);
-            // add P + C to table
-            table.push_back(P + C);
-            // change P
-            P = C;
+//            the files are spread over the threads, each file runs on one of them
+            ThreadPool pool;
+            const BatchSummary summary = runBatch(findBatchInputs(input), output, outputExtension, operation, pool);
+            std::cout << "Processed " << summary.numberOfFiles << " files, " << summary.failures.size() << " failed."
+                      << std::endl;
+            for (const auto &[inputFile, message] : summary.failures) {
+                std::cout << inputFile << ": " << message << std::endl;
+            }
+            exitCode = summary.failures.empty() ? 0 : 1;
         }
+    } catch (const MidCrackCodeError &error) {
+        std::cout << error.what() << std::endl;
+        exitCode = error.getExitCode();
     }
-    // add code for P to output
-    auto it = find(table.begin(), table.end(), P);
-    int index = it - table.begin();
-    output.push_back(index);
-
-    // create inputFile and add the compressed mid-crack code
-    // output to .bin
-    std::ofstream outputFile(compressionOutputFile, std::ios::binary);
-    if (!outputFile.is_open()) {
-        std::cout << "The inputFile could not be opened." << std::endl;
-        exit(1);
-    }
-
-    // get number of bytes required for the output codes
-    unsigned char numberOfBytesInCode = (int)ceil(log2(output.size())/8);
-    outputFile << numberOfBytesInCode;
-    // output the codes
-    for(auto o: output) {
-        outputFile.write((char*)&o, numberOfBytesInCode);
-    }
-
-    outputFile.close();
+    // the statistics of the stages that ran, also of a failed run
+    if (stats) writeStatsJson(std::cerr);
+    return exitCode;
 }
 
 void printUsage() {
@@ -149,177 +265,74 @@ void printUsage() {
     std::cout << "\tConverting from mid-crack code: -i [midCrackCode.txt] [imageFile.bmp]" << std::endl;
     std::cout << "\tCompressing mid-crack code: -c [midCrackCode.txt] [compressedMidCrackCode.bin]" << std::endl;
     std::cout << "\tDecompressing mid-crack code: -d [compressedMidCrackCode.bin] [midCrackCode.txt]" << std::endl;
+    std::cout << "\tConverting to compressed mid-crack code: -mc [imageFile.bmp] [compressedMidCrackCode.bin]"
+              << std::endl;
+    std::cout << "\tConverting from compressed mid-crack code: -di [compressedMidCrackCode.bin] [imageFile.bmp]"
+              << std::endl;
+    std::cout << "\tShape metrics of mid-crack code: -s [midCrackCode.txt] [metrics.json]" << std::endl;
+    std::cout << "\tShape metrics of compressed mid-crack code: -ds [compressedMidCrackCode.bin] [metrics.json]"
+              << std::endl;
+    std::cout << "\tBatch: -b [-m|-i|-c|-d|-mc|-di|-s|-ds] [inputDirectory|pattern|manifest.txt] [outputDirectory]"
+              << std::endl;
+    std::cout << "\tTraining an LZW dictionary from mid-crack codes: -t [inputDirectory|pattern|manifest.txt]"
+                 " [dictionary.lzd]" << std::endl;
+    std::cout << "Mid-crack code files ending with .mcc are binary with 3 bits per digit, other files are text."
+              << std::endl;
+    std::cout << "Settings (the settings of -m and -c also apply to -mc):" << std::endl;
+    std::cout << "\t--threshold=[0-256|otsu] : pixels darker than the threshold are black (default 128)" << std::endl;
+    std::cout << "\t--all : with -m, trace the contours of all the objects, not only the first one" << std::endl;
+    std::cout << "\t--holes : with -m, trace the contours of all the objects and their holes" << std::endl;
+    std::cout << "\t--engine=[trace|tiled|stream] : with -m, trace whole contours one by one, trace horizontal"
+                 " stripes of the image in parallel and join the parts, or read the image once from the top and join"
+                 " the parts of each stripe as it is read (default trace)" << std::endl;
+    std::cout << "\t--stripe-height=[rows] : with --engine=tiled or stream, number of rows in each stripe" << std::endl;
+    std::cout << "\t--fill : with -i and -di, fill the shapes instead of drawing only their edges" << std::endl;
+    std::cout << "\t--image-format=[bmp24|bmp8|bmp1|pbm] : with -i and -di, write a .bmp image with 24, 8 or 1 bits"
+                 " per pixel or a binary .pbm image (default bmp24)" << std::endl;
+    std::cout << "\t--codec=[lzw|turns] : with -c, compress the blocks with LZW codes or code the relative turns"
+                 " with an adaptive range coder (default lzw)" << std::endl;
+    std::cout << "\t--context-order=[0-4] : with --codec=turns, number of previous turns that select the"
+                 " probabilities of the next one (default 3)" << std::endl;
+    std::cout << "\t--max-code-width=[4-24] : with -c, largest width of the compressed codes in bits (default 16)"
+              << std::endl;
+    std::cout << "\t--full-dictionary=[reset|freeze] : with -c, start a new dictionary or keep the old one when it"
+                 " has 2^max-code-width codes (default reset)" << std::endl;
+    std::cout << "\t--legacy : with -c, write codes of whole bytes that can be read by older versions" << std::endl;
+    std::cout << "\t--dictionary=[dictionary.lzd] : with -c, start the LZW dictionary with the strings trained by -t;"
+                 " with -d, -di and -ds, the dictionary the codes were compressed with" << std::endl;
+    std::cout << "\t--dictionary-size=[strings] : with -t, largest number of strings of the dictionary (default "
+              << lzwDefaultDictionaryStrings << ")" << std::endl;
+    std::cout << "\t--block-size=[digits] : with -c, number of digits in each independently compressed block"
+                 " (default 1048576)" << std::endl;
+    std::cout << "\t--seek=[digit] --count=[digits] : with -d, decompress only these digits of all the chains"
+              << std::endl;
+    std::cout << "\t--stats : print the time, bytes and digits of every stage as JSON to the error output"
+              << std::endl;
 }
 
-void addMidCrackCodeOfImageToFile(const std::string &fileName, Image *image) {
-//    get mid-crack code
-    std::string solution = convertToMidCrackCode(image);
-
-//    create text file and add the mid-crack code
-    std::ofstream outputFile;
-    outputFile.open(fileName);
-    if (!outputFile.is_open()) {
-        std::cout << "The file could not be opened." << std::endl;
-        exit(1);
+/// Get the value of a setting of the form --name=number.
+/// \return False if the value is not a number that fits into all the digits of Number.
+template<typename Number>
+bool parseNumberSetting(const std::string &setting, Number &value) {
+    const std::size_t valueStart = setting.find('=') + 1;
+    if (setting.size() == valueStart || setting.size() - valueStart > std::numeric_limits<Number>::digits10 ||
+        setting.find_first_not_of("0123456789", valueStart) != std::string::npos) {
+        return false;
     }
-    outputFile << solution;
-    outputFile.close();
+    value = (Number) std::stoull(setting.substr(valueStart));
+    return true;
 }
 
-std::string convertToMidCrackCode(Image *image) {
-    // find starting position
-    std::pair<int, int> startingPosition;
-    for (int y = 0; y < image->getImageHeight(); ++y) {
-        for (int x = 0; x < image->getImageWidth(); ++x) {
-            if (image->getBitImage()[y][x] == 1) {
-                startingPosition = std::make_pair(y, x);
-                goto startingPositionSet;
-            }
-        }
-    }
-    startingPositionSet:
-
-    int previousDirectionOfEdge; // direction of the edge in the last found edge (top/right/bottom/left)
-    int newDirectionOfEdge = 2; // 2 = top; 0 = right; 6 = bottom; 4 = left;
-    int yDir[] = {1, 1, 1, 0, -1, -1, -1, 0}; // where to look in the y axis relative to the current edge
-    int xDir[] = {1, 0, -1, -1, -1, 0, 1, 1}; // where to look in the x axis relative to the current edge
-
-    std::string midCrackCode; // solution
-
-    std::pair<int, int> previousPositionOnOuterEdge; // position of pixel of last detected edge
-    std::pair<int, int> newPositionOnOuterEdge = startingPosition;
-    do { // trace edges of the image
-        previousPositionOnOuterEdge = newPositionOnOuterEdge;
-        int y = previousPositionOnOuterEdge.first;
-        int x = previousPositionOnOuterEdge.second;
-        previousDirectionOfEdge = newDirectionOfEdge; // current direction of edge (top/right/bottom/left)
-        int indexOfDirectionToLookAt =
-                8 - previousDirectionOfEdge; // first element in the xDir and yDir arrays to look at
-
-        for (int i = 0; i < 7; ++i) { // go through all neighbouring pixels in clockwise direction
-            int yDirToLookAt = yDir[(indexOfDirectionToLookAt + i) % 8];
-            int xDirToLookAt = xDir[(indexOfDirectionToLookAt + i) % 8];
-
-            int xToLookAt = x + xDirToLookAt;
-            int yToLookAt = y + yDirToLookAt;
-
-            int digitToAddToMidCrackCode = (previousDirectionOfEdge - i + 7) % 8;
-            if (i != 0 && i % 2 == 0)
-                midCrackCode += std::to_string(digitToAddToMidCrackCode); // add digit to mid-crack code
-
-//            if x and y are in bounds, then check, otherwise skip
-            if (xToLookAt >= 0 && yToLookAt >= 0 && xToLookAt < image->getImageWidth() &&
-                yToLookAt < image->getImageHeight()) {
-                if (image->getBitImage()[yToLookAt][xToLookAt] == 1) { // new pixel of the edge found
-                    newPositionOnOuterEdge = std::make_pair(yToLookAt, xToLookAt);
-                    int newDirectionDifference = 2 - 2 * ((i + 1) / 2);
-                    newDirectionOfEdge = (previousDirectionOfEdge + newDirectionDifference + 8) % 8;
-
-                    midCrackCode += std::to_string(digitToAddToMidCrackCode);
-                    break;
-                }
-            } else continue;
-        }
-    } while (startingPosition != newPositionOnOuterEdge);
-    // add additional edges around the starting position
-    if (newDirectionOfEdge == 0) midCrackCode += "531"; // if right
-    else if (newDirectionOfEdge == 6) midCrackCode += "31"; // if bottom
-    else if (newDirectionOfEdge == 4) midCrackCode += "1"; // if left
-
-    return midCrackCode;
+void checkStatus(const MidCrackStatus &status) {
+    if (!status.ok()) throw MidCrackCodeError(status.message, status.code);
 }
 
-Image *convertFromMidCrackCode(const std::string &fileName) {
-//    read mid-crack code from file
-    std::string midCrackCode;
-    std::ifstream file(fileName, std::ios::binary);
+void writeShapeMetrics(const std::string &fileName, const std::vector<ShapeMetrics> &metrics) {
+    StageTimer timer(Stage::writeFile);
+    std::ofstream file(fileName);
     if (!file.is_open()) {
-        std::cout << "The file could not be opened." << std::endl;
-        exit(1);
+        throw MidCrackCodeError("The file could not be opened.");
     }
-    std::istreambuf_iterator<char> inputIt(file), emptyInputIt;
-    std::back_insert_iterator<std::string> stringInsert(midCrackCode);
-    copy(inputIt, emptyInputIt, stringInsert);
-
-//    find bounds of image by keeping track of the relative position from the starting pixel
-    float xBoundsRight = 0, xBoundsLeft = 0, yBoundsDown = 0; // farthest relative x and y positions
-    float xCurrent = 0, yCurrent = 0; // current relative x and y positions
-    for (char &i : midCrackCode) {
-        int digit = i - '0';
-        if (digit == 0) xCurrent++; // right
-        else if (digit == 1) { // up and right
-            xCurrent += 0.5;
-            yCurrent -= 0.5;
-        } else if (digit == 2) yCurrent--; // up
-        else if (digit == 3) { // up and left
-            xCurrent -= 0.5;
-            yCurrent -= 0.5;
-        } else if (digit == 4) xCurrent--; // left
-        else if (digit == 5) { // down and left
-            xCurrent -= 0.5;
-            yCurrent += 0.5;
-        } else if (digit == 6) yCurrent++; // down
-        else if (digit == 7) { // down and right
-            xCurrent += 0.5;
-            yCurrent += 0.5;
-        } else {
-            std::cout << "Wrong digit." << std::endl;
-        }
-
-        // update bounds
-        if (xCurrent < xBoundsLeft) xBoundsLeft = xCurrent;
-        if (xCurrent > xBoundsRight) xBoundsRight = xCurrent;
-        if (yCurrent > yBoundsDown) yBoundsDown = yCurrent;
-        if (yCurrent < 0) {
-            std::cout << "Wrong bounds." << std::endl;
-        }
-    }
-
-//    set starting point
-    std::pair<int, int> startingPoint(0, (int) -xBoundsLeft);
-
-//    initialize image
-    auto *image = new Image();
-
-    int imageWidth = 1 + (int) xBoundsRight - (int) xBoundsLeft;
-    int imageHeight = (int) yBoundsDown;
-    image->setImageWidth(imageWidth);
-    image->setImageHeight(imageHeight);
-
-    int **bitImage;
-    bitImage = new int *[imageHeight];
-    for (int i = 0; i < imageHeight; ++i) {
-        bitImage[i] = new int[imageWidth];
-        for (int j = 0; j < imageWidth; ++j) {
-            bitImage[i][j] = 0;
-        }
-    }
-
-//    set edges from mid-crack code into bit image
-    int currentDirectionOfEdge; // direction of current edge
-    int newDirectionOfEdge = 2; // top = 2; right = 0; bottom = 6; left = 4;
-    std::pair<int, int> currentPoint;
-    std::pair<int, int> newPoint = startingPoint;
-    bitImage[newPoint.first][newPoint.second] = 1;
-
-    int yDir[] = {0, 1, 1, 0, 0, -1, 0, -1, -1, 0, 0, 1}; // where to look in the y axis relative to the current edge
-    int xDir[] = {0, 0, 1, 0, 1, 1, 0, 0, -1, 0, -1, -1}; // where to look in the x axis relative to the current edge
-
-    for (char &i : midCrackCode) {
-        int digit = i - '0';
-        currentDirectionOfEdge = newDirectionOfEdge;
-        currentPoint = newPoint;
-
-        newDirectionOfEdge = (12 - currentDirectionOfEdge + (digit * 2)) % 8;
-
-        int indexForXAndYArrays = (digit + (3 - currentDirectionOfEdge)) % 8 + ((currentDirectionOfEdge / 2) * 3);
-        int newY = currentPoint.first + yDir[indexForXAndYArrays];
-        int newX = currentPoint.second + xDir[indexForXAndYArrays];
-        newPoint = std::make_pair(newY, newX);
-
-        bitImage[newPoint.first][newPoint.second] = 1;
-    }
-    image->setBitImage(bitImage);
-
-    return image;
+    writeShapeMetricsJson(file, metrics);
+    addStageBytes(Stage::writeFile, 0, (std::uint64_t) file.tellp());
 }